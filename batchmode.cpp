@@ -0,0 +1,510 @@
+#include "batchmode.h"
+#include "mappedbuffer.h"
+#include "editjournal.h"
+#include <redasm/disassembler/listing/listingrenderer.h>
+#include <redasm/database/database.h>
+#include <redasm/redasm_context.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDirIterator>
+#include <QThreadPool>
+#include <QThread>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+    #include <unistd.h>
+#endif // Q_OS_LINUX
+
+class ListingExporter: public REDasm::ListingRenderer // Plain text, no fonts: QFontMetrics needs a QGuiApplication
+{
+    public:
+        ListingExporter(REDasm::DisassemblerAPI* disassembler): REDasm::ListingRenderer(disassembler), m_disassembler(disassembler) { this->setFlags(ListingExporter::HideSegmentName); }
+        void exportTo(QTextStream* stream) { this->render(0, m_disassembler->document()->size(), stream); }
+
+    protected:
+        void renderLine(const REDasm::RendererLine& rl) override { *static_cast<QTextStream*>(rl.userdata) << QString::fromStdString(rl.text) << "\n"; }
+
+    private:
+        REDasm::DisassemblerAPI* m_disassembler;
+};
+
+static QMutex s_journalmutex; // EditJournal is only used from the UI thread otherwise
+
+class BatchMode::Worker: public QRunnable
+{
+    public:
+        Worker(Job* job, const Options& options): QRunnable(), m_job(job), m_options(options) { }
+        void run() override { BatchMode::analyze(m_job, m_options); }
+
+    private:
+        Job* m_job;
+        const Options& m_options;
+};
+
+bool BatchMode::requested(int argc, char **argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(!std::strcmp(argv[i], BATCH_MODE_SWITCH))
+            return true;
+    }
+
+    return false;
+}
+
+int BatchMode::run(int argc, char **argv)
+{
+    QCoreApplication a(argc, argv); // No QApplication: works without a display
+    a.setOrganizationName("redasm.io");
+    a.setApplicationName("redasm");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("REDasm headless analysis");
+    parser.addHelpOption();
+    parser.addPositionalArgument("path", "Binary (or database) to analyze, or a directory of them");
+    parser.addOptions({
+        { "batch", "Run without UI, print the results as JSON" },
+        { "loader", "Loader name (autodetected if omitted)", "name" },
+        { "assembler", "Assembler id (loader's default if omitted)", "id" },
+        { "offset", "Load offset, custom addressing loaders only", "hex", "0" },
+        { "base", "Base address, custom addressing loaders only", "hex", "0" },
+        { "entry", "Entry point, custom addressing loaders only", "hex", "0" },
+        { { "o", "rdb" }, "Write the database to <path> (a directory when analyzing a directory)", "path" },
+        { "listing", "Export the listing to <path> (a directory when analyzing a directory)", "path" },
+        { { "j", "jobs" }, "Binaries analyzed concurrently", "count", QString::number(QThread::idealThreadCount()) },
+        { "timeout", "Stop an analysis after <seconds>, 0 = no limit", "seconds", "0" },
+        { "max-memory", "Memory budget per job in MiB, checked against the process' resident memory where available, 0 = no limit", "MiB", "0" },
+        { { "r", "recursive" }, "Include subdirectories" },
+        { "verbose", "Print REDasm's log to stderr" },
+    });
+
+    parser.process(a);
+
+    if(parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    Options options;
+    options.loader = parser.value("loader");
+    options.assembler = parser.value("assembler");
+    options.rdbfile = parser.value("rdb");
+    options.listingfile = parser.value("listing");
+    options.offset = parser.value("offset").toULongLong(nullptr, 16);
+    options.baseaddress = parser.value("base").toULongLong(nullptr, 16);
+    options.entrypoint = parser.value("entry").toULongLong(nullptr, 16);
+    options.timeout = parser.value("timeout").toLongLong() * 1000;
+    options.maxmemory = parser.value("max-memory").toLongLong() * 1024 * 1024;
+    options.residentcap = options.maxmemory && (BatchMode::residentMemory() > 0);
+
+    if(options.maxmemory && !options.residentcap)
+        std::cerr << "warning: memory usage cannot be polled on this platform, --max-memory only rejects larger inputs" << std::endl;
+
+    bool verbose = parser.isSet("verbose");
+
+    REDasm::ContextSettings ctxsettings;
+    ctxsettings.tempPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation).toStdString();
+    ctxsettings.searchPath = QDir::currentPath().toStdString();
+    ctxsettings.logCallback = [verbose](const std::string& s) { if(verbose) std::cerr << s << std::endl; };
+    ctxsettings.ignoreproblems = true;
+
+    REDasm::Context::sync(true); // disassemble() returns when the analysis is done, each job runs on its own pool thread
+    REDasm::init(ctxsettings);
+
+    QFileInfo fi(parser.positionalArguments().first());
+    std::vector< std::unique_ptr<Job> > jobs;
+    QJsonObject result;
+
+    if(fi.isDir())
+    {
+        QDir dir(fi.absoluteFilePath());
+        QDirIterator it(dir.path(), QDir::Files | QDir::Readable, parser.isSet("recursive") ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+
+        while(it.hasNext())
+        {
+            QString filepath = it.next();
+
+            if(BatchMode::skipFile(filepath, dir.path(), options))
+                continue;
+
+            auto job = std::make_unique<Job>();
+            job->filepath = filepath;
+
+            QString relpath = dir.relativeFilePath(job->filepath); // Outputs mirror the input tree
+
+            if(!options.rdbfile.isEmpty())
+                job->rdbfile = QDir(options.rdbfile).filePath(relpath + "." + RDB_SIGNATURE_EXT);
+            if(!options.listingfile.isEmpty())
+                job->listingfile = QDir(options.listingfile).filePath(relpath + ".txt");
+
+            jobs.push_back(std::move(job));
+        }
+
+        std::sort(jobs.begin(), jobs.end(), [](const std::unique_ptr<Job>& j1, const std::unique_ptr<Job>& j2) { return j1->filepath < j2->filepath; });
+
+        int maxjobs = std::max(parser.value("jobs").toInt(), 1);
+        QElapsedTimer timer;
+        timer.start();
+
+        BatchMode::runJobs(jobs, maxjobs, options);
+        result = BatchMode::summarize(jobs, maxjobs, timer.elapsed(), options);
+        std::cout << QJsonDocument(result).toJson(QJsonDocument::Indented).constData();
+        return result.value("summary").toObject().value("failed").toInt() ? 1 : 0;
+    }
+
+    auto job = std::make_unique<Job>();
+    job->filepath = fi.filePath();
+    job->rdbfile = options.rdbfile;
+    job->listingfile = options.listingfile;
+    jobs.push_back(std::move(job));
+
+    BatchMode::runJobs(jobs, 1, options);
+    result = jobs.front()->result;
+    result["problems"] = REDasm::Context::hasProblems();
+    result["memory_cap"] = BatchMode::memoryCap(options);
+    std::cout << QJsonDocument(result).toJson(QJsonDocument::Indented).constData();
+    return result.contains("error") ? 1 : 0;
+}
+
+bool BatchMode::skipFile(const QString &filepath, const QString &inputdir, const Options &options)
+{
+    if(QFileInfo(filepath).suffix() == EDIT_JOURNAL_EXT) // Written next to each database, not a binary
+        return true;
+
+    return BatchMode::isOutput(filepath, inputdir, options.rdbfile, QString(".") + RDB_SIGNATURE_EXT) ||
+           BatchMode::isOutput(filepath, inputdir, options.listingfile, ".txt");
+}
+
+bool BatchMode::isOutput(const QString &filepath, const QString &inputdir, const QString &outputdir, const QString &suffix)
+{
+    if(outputdir.isEmpty())
+        return false;
+
+    QString outputpath = QFileInfo(outputdir).absoluteFilePath();
+
+    if(outputpath != inputdir) // Skip the whole output tree when it is inside the input one
+        return filepath.startsWith(outputpath + "/");
+
+    // Outputs next to their inputs: only skip what an earlier run wrote for an existing input
+    return filepath.endsWith(suffix) && QFile::exists(filepath.left(filepath.size() - suffix.size()));
+}
+
+void BatchMode::runJobs(const std::vector<std::unique_ptr<Job> > &jobs, int maxjobs, const Options &options)
+{
+    QThreadPool pool; // Shared by every job, at most maxjobs disassemblers are alive at once
+    pool.setMaxThreadCount(maxjobs);
+
+    for(const auto& job : jobs)
+        pool.start(new Worker(job.get(), options));
+
+    while(!pool.waitForDone(BATCH_WATCHDOG_INTERVAL))
+        BatchMode::checkLimits(jobs, options);
+}
+
+QJsonObject BatchMode::summarize(const std::vector<std::unique_ptr<Job> > &jobs, int maxjobs, qint64 elapsed, const Options &options)
+{
+    QJsonArray results;
+    int failed = 0, stopped = 0;
+    qint64 disassembletime = 0;
+
+    for(const auto& job : jobs)
+    {
+        if(job->result.contains("error"))
+            failed++;
+        if(job->result.value("stopped").toBool())
+            stopped++;
+
+        disassembletime += static_cast<qint64>(job->result.value("disassemble_ms").toDouble());
+        results.append(job->result);
+    }
+
+    QJsonObject summary;
+    summary["files"] = static_cast<int>(jobs.size());
+    summary["analyzed"] = static_cast<int>(jobs.size()) - failed;
+    summary["failed"] = failed;
+    summary["stopped"] = stopped;
+    summary["jobs"] = maxjobs;
+    summary["elapsed_ms"] = elapsed;
+    summary["disassemble_ms"] = disassembletime; // Summed over jobs, compare with elapsed_ms for the speedup
+    summary["problems"] = REDasm::Context::hasProblems();
+    summary["memory_cap"] = BatchMode::memoryCap(options);
+
+    QJsonObject result;
+    result["summary"] = summary;
+    result["results"] = results;
+    return result;
+}
+
+QJsonObject BatchMode::memoryCap(const Options &options)
+{
+    QJsonObject cap;
+    cap["limit_mib"] = options.maxmemory / (1024 * 1024);
+
+    if(!options.maxmemory)
+        cap["enforced"] = "none";
+    else if(options.residentcap) // Jobs share the heap, so the budget is checked process-wide
+        cap["enforced"] = "process_resident";
+    else
+        cap["enforced"] = "input_size";
+
+    return cap;
+}
+
+void BatchMode::analyze(Job *job, const Options &options)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QJsonObject& result = job->result;
+    result["file"] = job->filepath;
+    job->inputsize = QFileInfo(job->filepath).size();
+
+    std::unique_ptr<REDasm::Disassembler> disassembler(BatchMode::createDisassembler(job->filepath, options, &result));
+
+    if(!disassembler)
+        return;
+
+    result["load_ms"] = timer.restart();
+
+    if(!result.value("database").toBool())
+    {
+        job->mutex.lock();
+        job->disassembler = disassembler.get();
+        job->timer.start();
+        job->mutex.unlock();
+
+        disassembler->disassemble();
+
+        QMutexLocker locker(&job->mutex);
+        job->disassembler = nullptr;
+
+        if(!job->stopreason.isEmpty())
+        {
+            result["error"] = job->stopreason;
+            result["stopped"] = true;
+        }
+    }
+
+    result["disassemble_ms"] = timer.restart();
+    BatchMode::countItems(disassembler.get(), &result);
+
+    if(!result.contains("error")) // Partial analyses are not written
+    {
+        if(!job->rdbfile.isEmpty())
+        {
+            QDir().mkpath(QFileInfo(job->rdbfile).absolutePath());
+
+            if(!REDasm::Database::save(disassembler.get(), job->rdbfile.toStdString(), QFileInfo(job->filepath).fileName().toStdString()))
+                result["error"] = QString::fromStdString(REDasm::Database::lastError());
+            else
+                result["rdb"] = job->rdbfile;
+
+            result["save_ms"] = timer.restart();
+        }
+
+        if(!job->listingfile.isEmpty())
+        {
+            QDir().mkpath(QFileInfo(job->listingfile).absolutePath());
+
+            if(!BatchMode::exportListing(disassembler.get(), job->listingfile))
+                result["error"] = QString("Cannot write %1").arg(job->listingfile);
+            else
+                result["listing"] = job->listingfile;
+
+            result["export_ms"] = timer.restart();
+        }
+    }
+
+    QMutexLocker locker(&s_journalmutex);
+    EditJournal::detach(disassembler.get());
+}
+
+REDasm::Disassembler *BatchMode::createDisassembler(const QString &filepath, const Options &options, QJsonObject *result)
+{
+    QFileInfo fi(filepath);
+
+    if(!fi.exists() || !fi.isFile() || !fi.isReadable())
+    {
+        (*result)["error"] = QString("Cannot read %1").arg(filepath);
+        return nullptr;
+    }
+
+    if(fi.suffix() == RDB_SIGNATURE_EXT)
+    {
+        std::string filename;
+        REDasm::Disassembler* disassembler = REDasm::Database::load(filepath.toStdString(), filename);
+
+        if(!disassembler)
+        {
+            (*result)["error"] = QString::fromStdString(REDasm::Database::lastError());
+            return nullptr;
+        }
+
+        s_journalmutex.lock(); // Same view as the UI: journaled edits on top of the database
+        EditJournal::attach(disassembler, filepath);
+        EditJournal::replay(disassembler);
+        s_journalmutex.unlock();
+
+        (*result)["database"] = true;
+        (*result)["loader"] = QString::fromStdString(disassembler->loader()->name());
+        (*result)["assembler"] = QString::fromStdString(disassembler->assembler()->name());
+        return disassembler;
+    }
+
+    if(options.maxmemory && (fi.size() > options.maxmemory)) // The analysis needs at least the input
+    {
+        (*result)["error"] = QString("%1 exceeds the memory cap").arg(filepath);
+        return nullptr;
+    }
+
+    std::unique_ptr<REDasm::AbstractBuffer> buffer(MappedBuffer::fromFile(filepath));
+
+    if(!buffer || buffer->empty())
+    {
+        (*result)["error"] = QString("%1 is empty").arg(filepath);
+        return nullptr;
+    }
+
+    REDasm::LoadRequest request(filepath.toStdString(), buffer.get());
+    REDasm::LoaderList loaders = REDasm::getLoaders(request, options.loader.isEmpty()); // Autodetection takes the first match, like the tests
+    const REDasm::LoaderPlugin_Entry* loaderentry = nullptr;
+
+    for(const REDasm::LoaderPlugin_Entry* entry : loaders)
+    {
+        if(!options.loader.isEmpty() && QString::fromStdString(entry->name()).compare(options.loader, Qt::CaseInsensitive))
+            continue;
+
+        loaderentry = entry;
+        break;
+    }
+
+    if(!loaderentry)
+    {
+        (*result)["error"] = options.loader.isEmpty() ? QString("No loader for %1").arg(filepath) : QString("Loader '%1' cannot load %2").arg(options.loader, filepath);
+        return nullptr;
+    }
+
+    std::unique_ptr<REDasm::LoaderPlugin> loader(loaderentry->init(request));
+    buffer.release(); // The loader owns the buffer
+
+    const REDasm::AssemblerPlugin_Entry* assemblerentry = nullptr;
+
+    if(!options.assembler.isEmpty())
+        assemblerentry = REDasm::getAssembler(options.assembler.toStdString());
+    else
+        assemblerentry = REDasm::getAssembler(loader->assembler());
+
+    if(!assemblerentry)
+    {
+        (*result)["error"] = QString("Cannot find assembler '%1'").arg(options.assembler.isEmpty() ? QString::fromStdString(loader->assembler()) : options.assembler);
+        return nullptr;
+    }
+
+    if(loaderentry->flags() & REDasm::LoaderFlags::CustomAddressing)
+        loader->build(assemblerentry->name(), options.offset, options.baseaddress, options.entrypoint);
+
+    (*result)["loader"] = QString::fromStdString(loaderentry->name());
+    (*result)["assembler"] = QString::fromStdString(assemblerentry->name());
+    return new REDasm::Disassembler(assemblerentry->init(), loader.release()); // Takes ownership
+}
+
+bool BatchMode::exportListing(REDasm::DisassemblerAPI *disassembler, const QString &listingfile)
+{
+    QFile f(listingfile);
+
+    if(!f.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+        return false;
+
+    QTextStream stream(&f);
+    ListingExporter exporter(disassembler);
+    exporter.exportTo(&stream);
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+void BatchMode::countItems(REDasm::DisassemblerAPI *disassembler, QJsonObject *result)
+{
+    auto lock = REDasm::s_lock_safe_ptr(disassembler->document());
+    int functions = 0;
+
+    for(const REDasm::ListingItem* item : lock->functions())
+    {
+        Q_UNUSED(item)
+        functions++;
+    }
+
+    (*result)["lines"] = static_cast<qint64>(lock->size());
+    (*result)["segments"] = static_cast<qint64>(lock->segmentsCount());
+    (*result)["functions"] = functions;
+}
+
+void BatchMode::checkLimits(const std::vector<std::unique_ptr<Job> > &jobs, const Options &options)
+{
+    Job* heaviest = nullptr;
+    int running = 0;
+
+    for(const auto& job : jobs)
+    {
+        QMutexLocker locker(&job->mutex);
+
+        if(!job->disassembler || !job->stopreason.isEmpty())
+            continue;
+
+        if(options.timeout && job->timer.hasExpired(options.timeout))
+        {
+            BatchMode::stopJob(job.get(), QString("Timed out after %1 s").arg(options.timeout / 1000));
+            continue;
+        }
+
+        running++;
+
+        if(!heaviest || (job->inputsize > heaviest->inputsize))
+            heaviest = job.get();
+    }
+
+    if(!heaviest || !options.residentcap)
+        return;
+
+    qint64 resident = BatchMode::residentMemory(); // Jobs share the heap: cap the process, stop the biggest input first
+
+    if(resident <= (options.maxmemory * running))
+        return;
+
+    QMutexLocker locker(&heaviest->mutex);
+
+    if(heaviest->disassembler && heaviest->stopreason.isEmpty())
+        BatchMode::stopJob(heaviest, QString("Exceeded the memory cap (%1 MiB resident)").arg(resident / (1024 * 1024)));
+}
+
+void BatchMode::stopJob(Job *job, const QString &reason) // job->mutex is held
+{
+    job->stopreason = reason;
+    job->disassembler->stop();
+}
+
+qint64 BatchMode::residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile f("/proc/self/statm");
+
+    if(!f.open(QFile::ReadOnly))
+        return 0;
+
+    QList<QByteArray> fields = f.readAll().split(' ');
+
+    if(fields.size() < 2)
+        return 0;
+
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return 0; // Not available, the memory cap only limits the input size
+#endif // Q_OS_LINUX
+}
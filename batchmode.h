@@ -0,0 +1,63 @@
+#ifndef BATCHMODE_H
+#define BATCHMODE_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <QMutex>
+#include <memory>
+#include <vector>
+#include <redasm/disassembler/disassembler.h>
+
+#define BATCH_MODE_SWITCH       "--batch"
+#define BATCH_WATCHDOG_INTERVAL 250 // ms
+
+class BatchMode // Headless analysis: no widgets are created, results are printed as JSON
+{
+    private:
+        struct Options {
+            QString loader, assembler;     // Autodetected when empty
+            QString rdbfile, listingfile;  // Written when not empty, directories when analyzing a directory
+            offset_t offset;               // Custom addressing only
+            address_t baseaddress, entrypoint;
+            qint64 timeout;                // ms per analysis, 0 = no limit
+            qint64 maxmemory;              // Bytes per job, 0 = no limit
+            bool residentcap;              // The process' resident memory can be polled
+        };
+
+        struct Job {
+            QString filepath, rdbfile, listingfile;
+            QJsonObject result;
+            qint64 inputsize = 0;
+            QMutex mutex;                                 // Guards the fields below, the watchdog runs on the main thread
+            REDasm::Disassembler* disassembler = nullptr; // Set while analyzing
+            QElapsedTimer timer;
+            QString stopreason;                           // Set by the watchdog
+        };
+
+        class Worker;
+
+    public:
+        BatchMode() = delete;
+        BatchMode(const BatchMode&) = delete;
+
+    public:
+        static bool requested(int argc, char** argv);
+        static int run(int argc, char** argv);
+
+    private:
+        static bool skipFile(const QString& filepath, const QString& inputdir, const Options& options);
+        static bool isOutput(const QString& filepath, const QString& inputdir, const QString& outputdir, const QString& suffix);
+        static void runJobs(const std::vector< std::unique_ptr<Job> >& jobs, int maxjobs, const Options& options);
+        static QJsonObject summarize(const std::vector< std::unique_ptr<Job> >& jobs, int maxjobs, qint64 elapsed, const Options& options);
+        static QJsonObject memoryCap(const Options& options);
+        static void analyze(Job* job, const Options& options);
+        static REDasm::Disassembler* createDisassembler(const QString& filepath, const Options& options, QJsonObject* result);
+        static bool exportListing(REDasm::DisassemblerAPI* disassembler, const QString& listingfile);
+        static void countItems(REDasm::DisassemblerAPI* disassembler, QJsonObject* result);
+        static void checkLimits(const std::vector< std::unique_ptr<Job> >& jobs, const Options& options);
+        static void stopJob(Job* job, const QString& reason);
+        static qint64 residentMemory();
+};
+
+#endif // BATCHMODE_H
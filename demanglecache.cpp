@@ -0,0 +1,92 @@
+#include "demanglecache.h"
+#include <redasm/disassembler/listing/listingdocument.h>
+#include <redasm/support/demangler.h>
+#include <QThreadPool>
+#include <QRunnable>
+
+class DemanglePrefetcher: public QRunnable
+{
+    public:
+        DemanglePrefetcher(const REDasm::DisassemblerPtr& disassembler): m_disassembler(disassembler) { }
+
+        void run() override
+        {
+            std::vector<std::string> names;
+
+            {
+                auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
+
+                for(auto it = lock->begin(); it != lock->end(); it++)
+                {
+                    const REDasm::ListingItem* item = it->get();
+
+                    if((item->type != REDasm::ListingItem::FunctionItem) && (item->type != REDasm::ListingItem::SymbolItem))
+                        continue;
+
+                    const REDasm::Symbol* symbol = lock->symbol(item->address);
+
+                    if(symbol)
+                        names.push_back(symbol->name);
+                }
+            } // Demangle without holding the document
+
+            for(const std::string& name : names)
+                DemangleCache::demangled(name);
+        }
+
+    private:
+        REDasm::DisassemblerPtr m_disassembler;
+};
+
+std::unordered_map<std::string, QString> DemangleCache::m_names;
+QReadWriteLock DemangleCache::m_lock;
+size_t DemangleCache::m_bytes = 0;
+
+QString DemangleCache::demangled(const std::string &name)
+{
+    QString result;
+
+    if(DemangleCache::lookup(name, &result))
+        return result;
+
+    return DemangleCache::insert(name);
+}
+
+void DemangleCache::prefetch(const REDasm::DisassemblerPtr &disassembler) { QThreadPool::globalInstance()->start(new DemanglePrefetcher(disassembler)); }
+
+void DemangleCache::clear()
+{
+    QWriteLocker locker(&m_lock);
+    m_names.clear();
+    m_bytes = 0;
+}
+
+bool DemangleCache::lookup(const std::string &name, QString *result)
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_names.find(name);
+
+    if(it == m_names.end())
+        return false;
+
+    *result = it->second; // Implicitly shared, no copy
+    return true;
+}
+
+QString DemangleCache::insert(const std::string &name)
+{
+    QString result = QString::fromStdString(REDasm::Demangler::demangled(name));
+    size_t bytes = name.size() + (result.size() * sizeof(QChar));
+
+    QWriteLocker locker(&m_lock);
+
+    if((m_bytes + bytes) > DEMANGLE_CACHE_MAX_BYTES) // Full: keep what we have and demangle on the fly
+        return result;
+
+    auto it = m_names.emplace(name, result);
+
+    if(it.second)
+        m_bytes += bytes;
+
+    return it.first->second;
+}
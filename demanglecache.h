@@ -0,0 +1,34 @@
+#ifndef DEMANGLECACHE_H
+#define DEMANGLECACHE_H
+
+#define DEMANGLED(n) DemangleCache::demangled(n)
+
+#include <unordered_map>
+#include <QReadWriteLock>
+#include <QString>
+#include <redasm/disassembler/disassemblerapi.h>
+
+#define DEMANGLE_CACHE_MAX_BYTES (64 * 1024 * 1024) // Keys and values
+
+class DemangleCache
+{
+    public:
+        DemangleCache() = delete;
+        DemangleCache(const DemangleCache&) = delete;
+
+    public:
+        static QString demangled(const std::string& name);
+        static void prefetch(const REDasm::DisassemblerPtr& disassembler);
+        static void clear();
+
+    private:
+        static bool lookup(const std::string& name, QString* result);
+        static QString insert(const std::string& name);
+
+    private:
+        static std::unordered_map<std::string, QString> m_names;
+        static QReadWriteLock m_lock;
+        static size_t m_bytes;
+};
+
+#endif // DEMANGLECACHE_H
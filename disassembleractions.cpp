@@ -1,4 +1,5 @@
 #include "disassembleractions.h"
+#include "editjournal.h"
 #include <redasm/disassembler/listing/listingdocument.h>
 #include <redasm/plugins/assembler/assembler.h>
 #include <QApplication>
@@ -6,12 +7,22 @@
 #include <QMessageBox>
 #include <QClipboard>
 
+QSet<REDasm::DisassemblerAPI*> DisassemblerActions::m_readonly;
+
 DisassemblerActions::DisassemblerActions(QWidget *parent): QObject(parent), m_renderer(nullptr) { this->createActions(); }
 DisassemblerActions::DisassemblerActions(REDasm::ListingRenderer* renderer, QWidget *parent) : QObject(parent), m_renderer(renderer) { this->createActions(); }
 void DisassemblerActions::setCurrentRenderer(REDasm::ListingRenderer *renderer) { m_renderer = renderer; }
 REDasm::ListingRenderer *DisassemblerActions::renderer() const { return m_renderer; }
 void DisassemblerActions::popup(const QPoint &pos) { if(m_renderer) m_contextmenu->exec(pos); }
 
+void DisassemblerActions::setReadOnly(REDasm::DisassemblerAPI *disassembler, bool b)
+{
+    if(b)
+        m_readonly.insert(disassembler);
+    else
+        m_readonly.remove(disassembler);
+}
+
 void DisassemblerActions::adjustActions()
 {
     if(!m_renderer)
@@ -59,7 +70,7 @@ void DisassemblerActions::adjustActions()
     m_actions[DisassemblerActions::XRefs]->setVisible(!m_renderer->disassembler()->busy());
 
     m_actions[DisassemblerActions::Rename]->setText(QString("Rename %1").arg(QString::fromStdString(symbol->name)));
-    m_actions[DisassemblerActions::Rename]->setVisible(!m_renderer->disassembler()->busy() && !symbol->isLocked());
+    m_actions[DisassemblerActions::Rename]->setVisible(!m_renderer->disassembler()->busy() && !this->isReadOnly() && !symbol->isLocked());
 
     m_actions[DisassemblerActions::CallGraph]->setVisible(!m_renderer->disassembler()->busy() && symbol->isFunction());
     m_actions[DisassemblerActions::CallGraph]->setText(QString("Callgraph %1").arg(QString::fromStdString(symbol->name)));
@@ -67,7 +78,7 @@ void DisassemblerActions::adjustActions()
     m_actions[DisassemblerActions::Follow]->setText(QString("Follow %1").arg(QString::fromStdString(symbol->name)));
     m_actions[DisassemblerActions::Follow]->setVisible(symbol->is(REDasm::SymbolType::Code));
 
-    m_actions[DisassemblerActions::Comment]->setVisible(!m_renderer->disassembler()->busy() && item->is(REDasm::ListingItem::InstructionItem));
+    m_actions[DisassemblerActions::Comment]->setVisible(!m_renderer->disassembler()->busy() && !this->isReadOnly() && item->is(REDasm::ListingItem::InstructionItem));
 
     m_actions[DisassemblerActions::HexDump]->setVisible(symbolsegment && !symbolsegment->is(REDasm::SegmentType::Bss));
     m_actions[DisassemblerActions::HexDumpFunction]->setVisible(itemsegment && !itemsegment->is(REDasm::SegmentType::Bss) && itemsegment->is(REDasm::SegmentType::Code));
@@ -116,7 +127,7 @@ void DisassemblerActions::createActions()
 
 void DisassemblerActions::renameSymbolUnderCursor()
 {
-    if(!m_renderer)
+    if(!m_renderer || this->isReadOnly())
         return;
 
     const REDasm::Symbol* symbol = m_renderer->symbolUnderCursor();
@@ -134,6 +145,7 @@ void DisassemblerActions::renameSymbolUnderCursor()
         return;
     }
 
+    EditJournal::record(m_renderer->disassembler(), { EditJournal::Rename, REDasm::ListingItem::SymbolItem, symbol->address, res });
     m_renderer->document()->rename(symbol->address, res.toStdString());
 }
 
@@ -229,6 +241,9 @@ void DisassemblerActions::followPointerHexDump()
 
 void DisassemblerActions::addComment()
 {
+    if(!m_renderer || this->isReadOnly())
+        return;
+
     const REDasm::ListingItem* currentitem =  m_renderer->document()->currentItem();
 
     bool ok = false;
@@ -240,6 +255,7 @@ void DisassemblerActions::addComment()
     if(!ok)
         return;
 
+    EditJournal::record(m_renderer->disassembler(), { EditJournal::Comment, static_cast<quint32>(currentitem->type), currentitem->address, res });
     m_renderer->document()->comment(currentitem, res.toStdString());
 }
 
@@ -255,3 +271,4 @@ void DisassemblerActions::copy()
 }
 
 QWidget *DisassemblerActions::widget() const { return qobject_cast<QWidget*>(this->parent()); }
+bool DisassemblerActions::isReadOnly() const { return m_renderer && m_readonly.contains(m_renderer->disassembler()); }
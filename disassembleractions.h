@@ -4,6 +4,7 @@
 #include <QAction>
 #include <QObject>
 #include <QMenu>
+#include <QSet>
 #include <redasm/disassembler/listing/listingrenderer.h>
 
 class DisassemblerActions : public QObject
@@ -22,6 +23,9 @@ class DisassemblerActions : public QObject
         void setCurrentRenderer(REDasm::ListingRenderer* renderer);
         REDasm::ListingRenderer* renderer() const;
 
+    public:
+        static void setReadOnly(REDasm::DisassemblerAPI* disassembler, bool b);
+
     public slots:
         bool followUnderCursor();
         void setEnabled(bool b);
@@ -43,6 +47,7 @@ class DisassemblerActions : public QObject
 
     private:
         QWidget* widget() const;
+        bool isReadOnly() const;
         void createActions();
 
     signals:
@@ -57,6 +62,7 @@ class DisassemblerActions : public QObject
         REDasm::ListingRenderer* m_renderer;
         QHash<int, QAction*> m_actions;
         QMenu* m_contextmenu;
+        static QSet<REDasm::DisassemblerAPI*> m_readonly; // Documents being saved, user edits are disabled
 };
 
 #endif // DISASSEMBLERACTIONS_H
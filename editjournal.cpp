@@ -0,0 +1,158 @@
+#include "editjournal.h"
+#include <redasm/disassembler/listing/listingdocument.h>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QFile>
+
+#define EDIT_JOURNAL_MAGIC   0x4A445252 // "RRDJ"
+#define EDIT_JOURNAL_VERSION 1
+
+QHash<REDasm::DisassemblerAPI*, EditJournal::Journal> EditJournal::m_journals;
+
+void EditJournal::attach(REDasm::DisassemblerAPI *disassembler, const QString &rdbfile)
+{
+    Journal& journal = m_journals[disassembler];
+    journal.filepath = EditJournal::journalFile(rdbfile);
+    journal.edits.clear();
+    journal.valid = EditJournal::read(&journal);
+}
+
+void EditJournal::detach(REDasm::DisassemblerAPI *disassembler) { m_journals.remove(disassembler); }
+
+void EditJournal::record(REDasm::DisassemblerAPI *disassembler, const EditJournal::Edit &edit)
+{
+    Journal& journal = m_journals[disassembler];
+    journal.edits.push_back(edit);
+
+    if(!journal.filepath.isEmpty() && !EditJournal::write(journal, journal.edits.size() - 1, false))
+        journal.valid = false;
+}
+
+void EditJournal::invalidate(REDasm::DisassemblerAPI *disassembler) { m_journals[disassembler].valid = false; }
+
+int EditJournal::replay(REDasm::DisassemblerAPI *disassembler)
+{
+    auto jit = m_journals.find(disassembler);
+
+    if(jit == m_journals.end())
+        return 0;
+
+    auto& document = disassembler->document();
+    int replayed = 0;
+
+    for(const Edit& edit : jit->edits)
+    {
+        if(edit.type == EditJournal::Rename)
+        {
+            document->rename(edit.address, edit.text.toStdString());
+            replayed++;
+            continue;
+        }
+
+        REDasm::ListingDocumentType::const_iterator it = document->end();
+
+        if(edit.itemtype == REDasm::ListingItem::InstructionItem)
+            it = document->instructionItem(edit.address);
+        else if(edit.itemtype == REDasm::ListingItem::SymbolItem)
+            it = document->symbolItem(edit.address);
+        else if(edit.itemtype == REDasm::ListingItem::FunctionItem)
+            it = document->functionItem(edit.address);
+        else if(edit.itemtype == REDasm::ListingItem::SegmentItem)
+            it = document->segmentItem(edit.address);
+
+        if(it == document->end())
+            continue;
+
+        document->comment(it->get(), edit.text.toStdString());
+        replayed++;
+    }
+
+    return replayed;
+}
+
+int EditJournal::pending(REDasm::DisassemblerAPI *disassembler) { return m_journals.value(disassembler).edits.size(); }
+
+bool EditJournal::canSaveIncrementally(REDasm::DisassemblerAPI *disassembler, const QString &rdbfile)
+{
+    auto it = m_journals.find(disassembler);
+
+    if((it == m_journals.end()) || !it->valid || (it->edits.size() >= EDIT_JOURNAL_MAX_EDITS))
+        return false;
+
+    return (it->filepath == EditJournal::journalFile(rdbfile)) && QFile::exists(rdbfile); // Every edit is already on disk
+}
+
+void EditJournal::compact(REDasm::DisassemblerAPI *disassembler, const QString &rdbfile, int saved)
+{
+    Journal& journal = m_journals[disassembler];
+    journal.filepath = EditJournal::journalFile(rdbfile);
+    journal.edits = journal.edits.mid(saved); // Edits made while saving aren't in the base
+    journal.valid = EditJournal::write(journal, 0, true);
+}
+
+QString EditJournal::journalFile(const QString &rdbfile) { return QString("%1.%2").arg(QFileInfo(rdbfile).absoluteFilePath(), EDIT_JOURNAL_EXT); }
+
+bool EditJournal::read(Journal *journal)
+{
+    QFile f(journal->filepath);
+
+    if(!f.exists())
+        return true;
+
+    if(!f.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream ds(&f);
+    quint32 magic = 0, version = 0;
+    ds >> magic >> version;
+
+    if((magic != EDIT_JOURNAL_MAGIC) || (version != EDIT_JOURNAL_VERSION))
+        return false;
+
+    qint64 pos = f.pos(); // End of the last complete entry
+
+    while(!ds.atEnd())
+    {
+        Edit edit;
+        quint64 address = 0;
+        ds >> edit.type >> edit.itemtype >> address >> edit.text;
+
+        if(ds.status() != QDataStream::Ok)
+            break;
+
+        edit.address = address;
+        journal->edits.push_back(edit);
+        pos = f.pos();
+    }
+
+    if(pos == f.size())
+        return true;
+
+    f.close();
+    return QFile::resize(journal->filepath, pos); // Torn tail: keep what was complete, new edits append after it
+}
+
+bool EditJournal::write(const Journal &journal, int from, bool truncate)
+{
+    QFile f(journal.filepath);
+
+    if(truncate && journal.edits.empty())
+        return !f.exists() || f.remove();
+
+    if(!f.open(truncate ? (QFile::WriteOnly | QFile::Truncate) : (QFile::WriteOnly | QFile::Append)))
+        return false;
+
+    QDataStream ds(&f);
+
+    if(!f.pos())
+        ds << static_cast<quint32>(EDIT_JOURNAL_MAGIC) << static_cast<quint32>(EDIT_JOURNAL_VERSION);
+
+    for(int i = from; i < journal.edits.size(); i++)
+    {
+        const Edit& edit = journal.edits[i];
+        ds << edit.type << edit.itemtype << static_cast<quint64>(edit.address) << edit.text;
+    }
+
+    f.flush();
+    return ds.status() == QDataStream::Ok;
+}
@@ -0,0 +1,56 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <redasm/disassembler/disassemblerapi.h>
+
+#define EDIT_JOURNAL_EXT          "journal"
+#define EDIT_JOURNAL_MAX_EDITS    1024 // Beyond this a save rewrites the database
+
+class EditJournal // User edits appended next to the .rdb, folded in by full saves
+{
+    public:
+        enum: quint8 { Rename = 0, Comment };
+
+        struct Edit {
+            quint8 type;
+            quint32 itemtype;
+            address_t address;
+            QString text;
+        };
+
+    public:
+        EditJournal() = delete;
+        EditJournal(const EditJournal&) = delete;
+
+    public:
+        static void attach(REDasm::DisassemblerAPI* disassembler, const QString& rdbfile);
+        static void detach(REDasm::DisassemblerAPI* disassembler);
+        static void record(REDasm::DisassemblerAPI* disassembler, const Edit& edit);
+        static void invalidate(REDasm::DisassemblerAPI* disassembler);
+        static int replay(REDasm::DisassemblerAPI* disassembler);
+        static int pending(REDasm::DisassemblerAPI* disassembler);
+        static bool canSaveIncrementally(REDasm::DisassemblerAPI* disassembler, const QString& rdbfile);
+        static void compact(REDasm::DisassemblerAPI* disassembler, const QString& rdbfile, int saved);
+
+    friend class EditJournalTest;
+
+    private:
+        struct Journal {
+            QString filepath;   // Empty until the database has been saved once
+            QList<Edit> edits;  // Not part of the base database yet
+            bool valid = true;  // False when the document changed outside the journal
+        };
+
+    private:
+        static QString journalFile(const QString& rdbfile);
+        static bool read(Journal* journal);
+        static bool write(const Journal& journal, int from, bool truncate);
+
+    private:
+        static QHash<REDasm::DisassemblerAPI*, Journal> m_journals;
+};
+
+#endif // EDITJOURNAL_H
@@ -3,6 +3,7 @@
 #include <QApplication>
 #include <QStyleFactory>
 #include "redasmsettings.h"
+#include "batchmode.h"
 
 #ifdef QT_DEBUG
     #include "unittest/unittest.h"
@@ -15,8 +16,13 @@ int main(int argc, char *argv[])
         return UnitTest::run();
 #endif // QT_DEBUG
 
+    if(BatchMode::requested(argc, argv))
+        return BatchMode::run(argc, argv);
+
     qRegisterMetaType<u64>("u64");
     qRegisterMetaType<address_t>("address_t");
+    qRegisterMetaType<REDasm::DisassemblerAPI*>("REDasm::DisassemblerAPI*");
+    qRegisterMetaType< QVector<int> >("QVector<int>");
     QApplication::setStyle(QStyleFactory::create("Fusion"));
 
     QApplication a(argc, argv);
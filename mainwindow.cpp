@@ -7,12 +7,56 @@
 #include "ui/redasmui.h"
 #include "redasmsettings.h"
 #include "themeprovider.h"
+#include "mappedbuffer.h"
+#include "editjournal.h"
+#include "demanglecache.h"
+#include "disassembleractions.h"
 #include <redasm/database/database.h>
 #include <QtWidgets>
 #include <QtCore>
 #include <QtGui>
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
+#define SAVE_PROGRESS_INTERVAL 250 // ms
+
+class MainWindow::SaveWorker: public QRunnable
+{
+    public:
+        SaveWorker(REDasm::DisassemblerAPI* disassembler, const QString& rdbfile, const QString& filename, MainWindow* mainwindow): m_disassembler(disassembler), m_rdbfile(rdbfile), m_filename(filename), m_mainwindow(mainwindow) { }
+
+        void run() override
+        {
+            bool saved = REDasm::Database::save(m_disassembler, m_rdbfile.toStdString(), m_filename.toStdString());
+            QString error = saved ? QString() : S_TO_QS(REDasm::Database::lastError());
+            QMetaObject::invokeMethod(m_mainwindow, "onDatabaseSaved", Qt::QueuedConnection, Q_ARG(REDasm::DisassemblerAPI*, m_disassembler), Q_ARG(bool, saved), Q_ARG(QString, error));
+        }
+
+    private:
+        REDasm::DisassemblerAPI* m_disassembler;
+        QString m_rdbfile, m_filename;
+        MainWindow* m_mainwindow;
+};
+
+class MainWindow::LoadWorker: public QRunnable
+{
+    public:
+        LoadWorker(const std::shared_ptr<LoadJob>& job, MainWindow* mainwindow): m_job(job), m_mainwindow(mainwindow) { }
+
+        void run() override
+        {
+            m_job->disassembler.reset(REDasm::Database::load(m_job->filepath.toStdString(), m_job->filename));
+
+            if(!m_job->disassembler)
+                m_job->error = REDasm::Database::lastError();
+
+            QMetaObject::invokeMethod(m_mainwindow, "onDatabaseLoaded", Qt::QueuedConnection, Q_ARG(u64, m_job->generation));
+        }
+
+    private:
+        std::shared_ptr<LoadJob> m_job;
+        MainWindow* m_mainwindow;
+};
+
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow), m_loadgeneration(0), m_savededits(0)
 {
     ui->setupUi(this);
     ui->toolBar->actions()[3]->setVisible(false); // Hide separator
@@ -58,6 +102,12 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     ui->statusBar->addPermanentWidget(m_pbproblems);
     ui->statusBar->addPermanentWidget(m_pbstatus);
 
+    m_savepool.setMaxThreadCount(1);
+    m_loadpool.setMaxThreadCount(1);
+    m_savetimer = new QTimer(this);
+    m_savetimer->setInterval(SAVE_PROGRESS_INTERVAL);
+    connect(m_savetimer, &QTimer::timeout, this, &MainWindow::updateSaveProgress);
+
     this->setAcceptDrops(true);
     this->loadWindowState();
     this->loadRecents();
@@ -87,7 +137,12 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     qApp->installEventFilter(this);
 }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow()
+{
+    m_savepool.waitForDone();
+    m_loadpool.waitForDone(); // Dropped loads still report back here
+    delete ui;
+}
 
 void MainWindow::closeEvent(QCloseEvent *e)
 {
@@ -178,11 +233,16 @@ void MainWindow::onSaveClicked()
     if(!currdv)
         return;
 
-    std::string rdbfile = QString("%1.%2").arg(m_fileinfo.baseName(), RDB_SIGNATURE_EXT).toStdString();
-    REDasm::log("Saving Database " + REDasm::quoted(rdbfile));
+    QString rdbfile = QString("%1.%2").arg(m_fileinfo.baseName(), RDB_SIGNATURE_EXT);
+
+    if(EditJournal::canSaveIncrementally(currdv->disassembler(), rdbfile))
+    {
+        REDasm::log("Database " + REDasm::quoted(rdbfile.toStdString()) + " is up to date, " +
+                    std::to_string(EditJournal::pending(currdv->disassembler())) + " edit(s) journaled");
+        return;
+    }
 
-    if(!REDasm::Database::save(currdv->disassembler(), rdbfile, m_fileinfo.fileName().toStdString()))
-        REDasm::log(REDasm::Database::lastError());
+    this->saveDatabase(rdbfile);
 }
 
 void MainWindow::onSaveAsClicked() // TODO: Handle multiple outputs
@@ -197,8 +257,7 @@ void MainWindow::onSaveAsClicked() // TODO: Handle multiple outputs
     if(!currdv)
         return;
 
-    if(!REDasm::Database::save(currdv->disassembler(), s.toStdString(), m_fileinfo.fileName().toStdString()))
-        REDasm::log(REDasm::Database::lastError());
+    this->saveDatabase(s);
 }
 
 void MainWindow::onRecentFileClicked()
@@ -221,6 +280,7 @@ void MainWindow::onSignaturesClicked()
 {
     SignaturesDialog dlgsignatures(this->currentDisassembler(), this);
     dlgsignatures.exec();
+    EditJournal::invalidate(this->currentDisassembler()); // Signatures rename symbols behind the journal
 }
 
 void MainWindow::onResetLayoutClicked()
@@ -284,21 +344,29 @@ void MainWindow::loadRecents()
 
 bool MainWindow::loadDatabase(const QString &filepath)
 {
+    if(m_fileinfo.suffix() == RDB_SIGNATURE_EXT) // Keep the UI alive while it's being read
+    {
+        auto job = std::make_shared<LoadJob>();
+        job->filepath = filepath;
+        job->generation = ++m_loadgeneration;
+        m_loadjob = job;
+
+        m_lblstatus->setText(QString("Loading %1...").arg(m_fileinfo.fileName()));
+        m_loadpool.start(new LoadWorker(job, this));
+        return true;
+    }
+
     std::string filename;
     REDasm::Disassembler* disassembler = REDasm::Database::load(filepath.toStdString(), filename);
 
     if(!disassembler)
-    {
-        if(m_fileinfo.suffix() == RDB_SIGNATURE_EXT)
-            REDasm::log(REDasm::Database::lastError());
-
         return false;
-    }
 
     REDasm::log("Selected loader " + REDasm::quoted(disassembler->loader()->name()) + " with " +
                                      REDasm::quoted(disassembler->assembler()->name()) + " instruction set");
 
     m_fileinfo = QFileInfo(QString::fromStdString(filename));
+    this->replayJournal(disassembler, filepath);
     this->showDisassemblerView(disassembler, true);
     return true;
 }
@@ -306,6 +374,7 @@ bool MainWindow::loadDatabase(const QString &filepath)
 void MainWindow::load(const QString& filepath)
 {
     this->closeFile();
+    m_loadjob.reset(); // A database still being read is dropped
 
     m_fileinfo = QFileInfo(filepath);
     QDir::setCurrent(m_fileinfo.path());
@@ -317,13 +386,15 @@ void MainWindow::load(const QString& filepath)
     if(this->loadDatabase(filepath))
         return;
 
-    REDasm::MemoryBuffer* buffer = REDasm::MemoryBuffer::fromFile(filepath.toStdString()); // TODO: Deallocate in case of user-cancel?
+    std::unique_ptr<REDasm::AbstractBuffer> buffer(MappedBuffer::fromFile(filepath));
 
-    if(buffer && !buffer->empty())
-    {
-        REDasm::LoadRequest request(filepath.toStdString(), buffer);
-        this->selectLoader(request);
-    }
+    if(!buffer || buffer->empty())
+        return;
+
+    REDasm::LoadRequest request(filepath.toStdString(), buffer.get());
+
+    if(this->selectLoader(request)) // The loader owns the buffer
+        buffer.release();
 }
 
 void MainWindow::checkCommandLine()
@@ -347,6 +418,90 @@ void MainWindow::checkCommandLine()
     }
 }
 
+void MainWindow::saveDatabase(const QString &rdbfile)
+{
+    DisassemblerView* currdv = dynamic_cast<DisassemblerView*>(ui->stackView->currentWidget());
+
+    if(!currdv || this->isSaving())
+        return;
+
+    REDasm::log("Saving Database " + REDasm::quoted(rdbfile.toStdString()));
+
+    // Analysis is idle (save is disabled while busy), user edits wait until the worker is done
+    DisassemblerActions::setReadOnly(currdv->disassembler(), true);
+    m_savefile = rdbfile;
+    m_savededits = EditJournal::pending(currdv->disassembler());
+    this->setStandardActionsEnabled(false);
+    this->updateSaveProgress();
+    m_lblprogress->setVisible(true);
+    m_savetimer->start();
+
+    m_savepool.start(new SaveWorker(currdv->disassembler(), rdbfile, m_fileinfo.fileName(), this));
+}
+
+void MainWindow::onDatabaseLoaded(u64 generation)
+{
+    if(!m_loadjob || (m_loadjob->generation != generation))
+        return;
+
+    std::shared_ptr<LoadJob> job = m_loadjob;
+    m_loadjob.reset();
+    m_lblstatus->clear();
+
+    if(!job->disassembler)
+    {
+        REDasm::log(job->error);
+        return;
+    }
+
+    REDasm::Disassembler* disassembler = job->disassembler.release();
+
+    REDasm::log("Selected loader " + REDasm::quoted(disassembler->loader()->name()) + " with " +
+                                     REDasm::quoted(disassembler->assembler()->name()) + " instruction set");
+
+    m_fileinfo = QFileInfo(QString::fromStdString(job->filename));
+    this->replayJournal(disassembler, job->filepath);
+    this->showDisassemblerView(disassembler, true);
+}
+
+void MainWindow::replayJournal(REDasm::DisassemblerAPI *disassembler, const QString &rdbfile)
+{
+    EditJournal::attach(disassembler, rdbfile);
+    int replayed = EditJournal::replay(disassembler);
+
+    if(replayed)
+        REDasm::log("Replayed " + std::to_string(replayed) + " journaled edit(s)");
+}
+
+bool MainWindow::isSaving() const { return !m_savefile.isEmpty(); }
+
+void MainWindow::updateSaveProgress()
+{
+    QFileInfo fi(m_savefile);
+    m_lblprogress->setText(QString("Saving %1: %2 MiB written").arg(fi.fileName()).arg(fi.exists() ? (fi.size() / (1024 * 1024)) : 0));
+}
+
+void MainWindow::onDatabaseSaved(REDasm::DisassemblerAPI *disassembler, bool saved, const QString &error)
+{
+    if(!this->isSaving() || (disassembler != this->currentDisassembler())) // File closed or replaced while saving
+        return;
+
+    m_savetimer->stop();
+    DisassemblerActions::setReadOnly(disassembler, false);
+
+    if(saved)
+    {
+        EditJournal::compact(disassembler, m_savefile, m_savededits);
+        REDasm::log("Database saved to " + REDasm::quoted(m_savefile.toStdString()));
+    }
+    else
+        REDasm::log(error.toStdString());
+
+    m_savefile.clear();
+    m_lblprogress->clear();
+    this->checkDisassemblerStatus();
+}
+
 void MainWindow::setStandardActionsEnabled(bool b)
 {
     ui->action_Save->setEnabled(b);
@@ -399,6 +554,10 @@ bool MainWindow::canClose()
 
 void MainWindow::closeFile()
 {
+    m_savepool.waitForDone(); // The database being written still references the disassembler
+    m_savetimer->stop();
+    m_savefile.clear(); // Its queued completion is stale now
+
     REDasm::DisassemblerAPI* disassembler = this->currentDisassembler();
 
     // TODO: messageBox for confirmation?
@@ -406,6 +565,8 @@ void MainWindow::closeFile()
     {
         disassembler->busyChanged.disconnect();
         disassembler->stop();
+        EditJournal::detach(disassembler);
+        DisassemblerActions::setReadOnly(disassembler, false);
     }
 
     DisassemblerView* oldview = this->currentDisassemblerView();
@@ -426,14 +587,15 @@ void MainWindow::closeFile()
     this->setStandardActionsEnabled(false);
     this->setViewWidgetsVisible(false);
     REDasm::Context::clearProblems();
+    DemangleCache::clear();
 }
 
-void MainWindow::selectLoader(REDasm::LoadRequest &request)
+bool MainWindow::selectLoader(REDasm::LoadRequest &request)
 {
     LoaderDialog dlgloader(request, this);
 
     if(dlgloader.exec() != LoaderDialog::Accepted)
-        return;
+        return false;
 
     const REDasm::AssemblerPlugin_Entry* assemblerentry = nullptr;
     const REDasm::LoaderPlugin_Entry* loaderentry = dlgloader.selectedLoader();
@@ -447,7 +609,7 @@ void MainWindow::selectLoader(REDasm::LoadRequest &request)
     if(!assemblerentry)
     {
         QMessageBox::information(this, "Assembler not found", QString("Cannot find assembler '%1'").arg(QString::fromStdString(loader->assembler())));
-        return;
+        return true;
     }
 
     if(loaderentry->flags() & REDasm::LoaderFlags::CustomAddressing)
@@ -464,6 +626,7 @@ void MainWindow::selectLoader(REDasm::LoadRequest &request)
     });
 
     this->showDisassemblerView(disassembler, false); // Take ownership
+    return true;
 }
 
 void MainWindow::setViewWidgetsVisible(bool b)
@@ -516,11 +679,11 @@ void MainWindow::checkDisassemblerStatus()
         m_pbstatus->setStyleSheet("color: green;");
 
     m_pbstatus->setVisible(true);
-    m_lblprogress->setVisible(disassembler->busy());
+    m_lblprogress->setVisible(disassembler->busy() || this->isSaving());
     m_pbproblems->setText(QString::number(REDasm::Context::problemsCount()) + " problem(s)");
     m_pbproblems->setVisible(!disassembler->busy() && REDasm::Context::hasProblems());
 
-    this->setStandardActionsEnabled(!disassembler->busy());
+    this->setStandardActionsEnabled(!disassembler->busy() && !this->isSaving());
     ui->action_Close->setEnabled(true);
 }
 
@@ -2,7 +2,9 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QThreadPool>
 #include <QPushButton>
+#include <QTimer>
 #include <QFileInfo>
 #include <QLabel>
 #include <redasm/plugins/plugins.h>
@@ -18,6 +20,17 @@ class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
+    private:
+        struct LoadJob {
+            QString filepath;
+            std::unique_ptr<REDasm::Disassembler> disassembler;
+            std::string filename, error;
+            u64 generation;
+        };
+
+        class SaveWorker;
+        class LoadWorker;
+
     public:
         explicit MainWindow(QWidget *parent = 0);
         ~MainWindow();
@@ -43,6 +56,9 @@ class MainWindow : public QMainWindow
         void checkDisassemblerStatus();
         void showProblems();
         void closeFile();
+        void updateSaveProgress();
+        void onDatabaseSaved(REDasm::DisassemblerAPI* disassembler, bool saved, const QString& error);
+        void onDatabaseLoaded(u64 generation);
 
     private:
         DisassemblerView* currentDisassemblerView() const;
@@ -53,8 +69,11 @@ class MainWindow : public QMainWindow
         void load(const QString &filepath);
         void checkCommandLine();
         void setStandardActionsEnabled(bool b);
+        void saveDatabase(const QString& rdbfile);
+        void replayJournal(REDasm::DisassemblerAPI* disassembler, const QString& rdbfile);
+        bool isSaving() const;
         void showDisassemblerView(REDasm::Disassembler *disassembler, bool fromdatabase);
-        void selectLoader(REDasm::LoadRequest &request);
+        bool selectLoader(REDasm::LoadRequest &request);
         void setViewWidgetsVisible(bool b);
         void configureWebEngine();
         bool canClose();
@@ -66,6 +85,12 @@ class MainWindow : public QMainWindow
         QStringList m_recents;
         QPushButton* m_pbstatus;
         QPushButton* m_pbproblems;
+        QThreadPool m_savepool, m_loadpool; // One at a time each, closing a file only waits for saves
+        std::shared_ptr<LoadJob> m_loadjob;
+        u64 m_loadgeneration;
+        QTimer* m_savetimer;
+        QString m_savefile;
+        int m_savededits;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,57 @@
+#include "mappedbuffer.h"
+
+MappedBuffer::MappedBuffer(const QString &filepath): m_file(filepath), m_data(nullptr), m_size(0), m_mapped(false) { }
+
+MappedBuffer::~MappedBuffer()
+{
+    if(m_mapped)
+        m_file.unmap(m_data);
+}
+
+u8 *MappedBuffer::data() const { return m_data; }
+size_t MappedBuffer::size() const { return m_size; }
+
+void MappedBuffer::resize(size_t size)
+{
+    if(size == m_size)
+        return;
+
+    if(m_mapped) // A mapping can't grow, move to the heap
+    {
+        m_heap.assign(m_data, m_data + std::min(size, m_size));
+        m_file.unmap(m_data);
+        m_file.close();
+        m_mapped = false;
+    }
+
+    m_heap.resize(size);
+    m_data = m_heap.data();
+    m_size = size;
+}
+
+REDasm::AbstractBuffer *MappedBuffer::fromFile(const QString &filepath)
+{
+    MappedBuffer* buffer = new MappedBuffer(filepath);
+
+    if(buffer->map())
+        return buffer;
+
+    delete buffer; // Pipes, special files, etc: read them the old way
+    return REDasm::MemoryBuffer::fromFile(filepath.toStdString());
+}
+
+bool MappedBuffer::map()
+{
+    if(!m_file.open(QFile::ReadOnly) || !m_file.size())
+        return false;
+
+    // Pages are shared with the page cache, loaders that patch bytes get private copies
+    m_data = m_file.map(0, m_file.size(), QFile::MapPrivateOption);
+
+    if(!m_data)
+        return false;
+
+    m_size = static_cast<size_t>(m_file.size());
+    m_mapped = true;
+    return true;
+}
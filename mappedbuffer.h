@@ -0,0 +1,33 @@
+#ifndef MAPPEDBUFFER_H
+#define MAPPEDBUFFER_H
+
+#include <QFile>
+#include <vector>
+#include <redasm/buffer/memorybuffer.h>
+
+class MappedBuffer: public REDasm::AbstractBuffer // Read-only file mapping, private copy on write
+{
+    public:
+        MappedBuffer() = delete;
+        MappedBuffer(const MappedBuffer&) = delete;
+        virtual ~MappedBuffer();
+        u8* data() const override;
+        size_t size() const override;
+        void resize(size_t size) override;
+
+    public:
+        static REDasm::AbstractBuffer* fromFile(const QString& filepath);
+
+    private:
+        MappedBuffer(const QString& filepath);
+        bool map();
+
+    private:
+        QFile m_file;
+        std::vector<u8> m_heap; // Used once the mapping has been resized
+        u8* m_data;
+        size_t m_size;
+        bool m_mapped;
+};
+
+#endif // MAPPEDBUFFER_H
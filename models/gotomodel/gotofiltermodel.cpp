@@ -2,31 +2,42 @@
 
 GotoFilterModel::GotoFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
 {
-    this->setFilterKeyColumn(-1);
-    this->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    this->setSourceModel(new GotoModel(this));
+    GotoModel* gotomodel = new GotoModel(this);
+    this->setSourceModel(gotomodel);
+
+    connect(gotomodel, &GotoModel::modelReset, this, &GotoFilterModel::updateFiltering);
+    connect(gotomodel, &GotoModel::rowsInserted, this, &GotoFilterModel::updateFiltering);
+    connect(gotomodel, &GotoModel::rowsRemoved, this, &GotoFilterModel::updateFiltering);
 }
 
 void GotoFilterModel::setDisassembler(const REDasm::DisassemblerPtr &disassembler) { static_cast<GotoModel*>(this->sourceModel())->setDisassembler(disassembler); }
 
-bool GotoFilterModel::filterAcceptsRow(int sourcerow, const QModelIndex &sourceparent) const
+void GotoFilterModel::setFilter(const QString &filter)
 {
-    const REDasm::ListingItem* item = reinterpret_cast<const REDasm::ListingItem*>(this->sourceModel()->index(sourcerow, 0, sourceparent).internalPointer());
+    if(m_filter == filter)
+        return;
+
+    m_filter = filter;
+    this->updateFiltering();
+}
 
-    if(!item)
+bool GotoFilterModel::filterAcceptsRow(int sourcerow, const QModelIndex &) const
+{
+    if(m_filter.isEmpty())
+        return true;
+
+    if(sourcerow >= m_accepted.size()) // Not searched yet
         return false;
 
-    switch(item->type)
-    {
-        case REDasm::ListingItem::SegmentItem:
-        case REDasm::ListingItem::FunctionItem:
-        case REDasm::ListingItem::SymbolItem:
-        case REDasm::ListingItem::TypeItem:
-            return QSortFilterProxyModel::filterAcceptsRow(sourcerow, sourceparent);
+    return m_accepted[sourcerow];
+}
 
-        default:
-            break;
-    }
+void GotoFilterModel::updateFiltering()
+{
+    if(!m_filter.isEmpty())
+        static_cast<GotoModel*>(this->sourceModel())->search(m_filter, &m_accepted);
+    else
+        m_accepted.clear();
 
-    return false;
+    this->invalidateFilter();
 }
@@ -11,9 +11,17 @@ class GotoFilterModel : public QSortFilterProxyModel
     public:
         explicit GotoFilterModel(QObject *parent = nullptr);
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
+        void setFilter(const QString& filter);
 
     protected:
         bool filterAcceptsRow(int sourcerow, const QModelIndex &sourceparent) const override;
+
+    private slots:
+        void updateFiltering();
+
+    private:
+        QVector<bool> m_accepted;
+        QString m_filter;
 };
 
 #endif // GOTOFILTERMODEL_H
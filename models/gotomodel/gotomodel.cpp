@@ -1,13 +1,63 @@
 #include "gotomodel.h"
 #include "../../themeprovider.h"
+#include "../../demanglecache.h"
 #include <redasm/disassembler/disassembler.h>
+#include <algorithm>
 
-GotoModel::GotoModel(QObject *parent) : DisassemblerModel(parent) { }
+#define TRIGRAM_LENGTH 3
+
+GotoModel::GotoModel(QObject *parent) : DisassemblerModel(parent), m_trigramsdirty(true) { }
+
+GotoModel::~GotoModel()
+{
+    if(!m_disassembler)
+        return;
+
+    EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+    EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+}
 
 void GotoModel::setDisassembler(const REDasm::DisassemblerPtr &disassembler)
 {
-    this->beginResetModel();
+    if(m_disassembler)
+    {
+        EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+        EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+    }
+
     DisassemblerModel::setDisassembler(disassembler);
+    this->loadItems();
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, std::bind(&GotoModel::onListingChanged, this, std::placeholders::_1));
+
+    EVENT_CONNECT(m_disassembler, busyChanged, this, [&]() {
+        if(m_disassembler->busy())
+            return;
+
+        QMetaObject::invokeMethod(this, "loadItems", Qt::QueuedConnection); // Catch up with the analysis on the UI thread
+    });
+}
+
+void GotoModel::loadItems()
+{
+    this->beginResetModel();
+    m_items.clear();
+    m_searchtext.clear();
+    m_trigramsdirty = true;
+
+    auto& document = m_disassembler->document();
+
+    for(auto it = document->begin(); it != document->end(); it++)
+    {
+        const REDasm::ListingItem* item = it->get();
+
+        if(!GotoModel::isNavigable(item))
+            continue;
+
+        m_items.push_back(item);
+        m_searchtext.push_back(this->searchText(item));
+    }
+
     this->endResetModel();
 }
 
@@ -67,14 +117,202 @@ QVariant GotoModel::headerData(int section, Qt::Orientation orientation, int rol
 
 QModelIndex GotoModel::index(int row, int column, const QModelIndex &parent) const
 {
-    if(!m_disassembler)
+    Q_UNUSED(parent)
+
+    if(!m_disassembler || (row < 0) || (row >= m_items.size()))
         return QModelIndex();
 
-    return this->createIndex(row, column, m_disassembler->document()->itemAt(row));
+    return this->createIndex(row, column, const_cast<REDasm::ListingItem*>(m_items[row]));
 }
 
 int GotoModel::columnCount(const QModelIndex &) const { return 3; }
-int GotoModel::rowCount(const QModelIndex &) const { return m_disassembler ? m_disassembler->document()->size() : 0; }
+int GotoModel::rowCount(const QModelIndex &) const { return m_items.size(); }
+
+void GotoModel::search(const QString &filter, QVector<bool> *accepted)
+{
+    QString f = filter.toLower();
+    accepted->fill(false, m_items.size());
+
+    if(f.isEmpty())
+        return;
+
+    bool found = false;
+
+    if(f.length() >= TRIGRAM_LENGTH)
+    {
+        if(m_trigramsdirty)
+            this->buildTrigrams();
+
+        QVector<quint64> ftrigrams;
+        GotoModel::trigrams(f, &ftrigrams);
+
+        const QVector<int>* candidates = nullptr;
+
+        for(quint64 trigram : ftrigrams) // Verify only the rarest trigram's rows
+        {
+            auto it = m_trigramindex.constFind(trigram);
+
+            if(it == m_trigramindex.constEnd())
+            {
+                candidates = nullptr;
+                break;
+            }
+
+            if(!candidates || (it->size() < candidates->size()))
+                candidates = &it.value();
+        }
+
+        if(candidates)
+        {
+            for(int row : *candidates)
+            {
+                if(!m_searchtext[row].contains(f))
+                    continue;
+
+                (*accepted)[row] = true;
+                found = true;
+            }
+        }
+    }
+    else
+    {
+        for(int i = 0; i < m_searchtext.size(); i++)
+        {
+            if(!m_searchtext[i].contains(f))
+                continue;
+
+            (*accepted)[i] = true;
+            found = true;
+        }
+    }
+
+    if(found)
+        return;
+
+    for(int i = 0; i < m_searchtext.size(); i++) // No exact hits, try a fuzzy match
+        (*accepted)[i] = GotoModel::fuzzyMatch(m_searchtext[i], f);
+}
+
+void GotoModel::onListingChanged(const REDasm::ListingDocumentChanged *ldc)
+{
+    if(m_disassembler->busy() || !GotoModel::isNavigable(ldc->item)) // Analysis threads: reloaded when it's done
+        return;
+
+    if(ldc->isRemoved())
+    {
+        int row = m_items.indexOf(ldc->item);
+
+        if(row == -1)
+            return;
+
+        this->beginRemoveRows(QModelIndex(), row, row);
+        m_items.remove(row);
+        m_searchtext.remove(row);
+        this->endRemoveRows();
+    }
+    else if(ldc->isInserted())
+    {
+        int row = this->insertionRow(ldc->item);
+        this->beginInsertRows(QModelIndex(), row, row);
+        m_items.insert(row, ldc->item);
+        m_searchtext.insert(row, this->searchText(ldc->item));
+        this->endInsertRows();
+    }
+    else // Renamed: search by the new name only
+    {
+        int row = m_items.indexOf(ldc->item);
+
+        if(row == -1)
+            return;
+
+        m_searchtext[row] = this->searchText(ldc->item);
+        emit dataChanged(this->index(row, 0), this->index(row, this->columnCount(QModelIndex()) - 1));
+    }
+
+    m_trigramsdirty = true;
+}
+
+bool GotoModel::isNavigable(const REDasm::ListingItem *item)
+{
+    switch(item->type)
+    {
+        case REDasm::ListingItem::SegmentItem:
+        case REDasm::ListingItem::FunctionItem:
+        case REDasm::ListingItem::SymbolItem:
+        case REDasm::ListingItem::TypeItem:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+bool GotoModel::fuzzyMatch(const QString &text, const QString &filter)
+{
+    int i = 0;
+
+    for(QChar ch : text) // Filter characters must appear in order
+    {
+        if(ch != filter[i])
+            continue;
+
+        if(++i == filter.length())
+            return true;
+    }
+
+    return false;
+}
+
+void GotoModel::trigrams(const QString &s, QVector<quint64> *result)
+{
+    for(int i = 0; (i + TRIGRAM_LENGTH) <= s.length(); i++)
+    {
+        quint64 trigram = (static_cast<quint64>(s[i].unicode()) << 32) |
+                          (static_cast<quint64>(s[i + 1].unicode()) << 16) |
+                           static_cast<quint64>(s[i + 2].unicode());
+
+        result->push_back(trigram);
+    }
+}
+
+QString GotoModel::searchText(const REDasm::ListingItem *item) const
+{
+    QString address = S_TO_QS(REDasm::hex(item->address, m_disassembler->assembler()->bits()));
+    return (address + "\n" + this->itemName(item) + "\n" + this->itemType(item)).toLower(); // Separators keep matches inside a column
+}
+
+int GotoModel::insertionRow(const REDasm::ListingItem *item) const
+{
+    auto it = std::upper_bound(m_items.begin(), m_items.end(), item, [](const REDasm::ListingItem* item1, const REDasm::ListingItem* item2) {
+        return item1->address < item2->address;
+    });
+
+    return static_cast<int>(std::distance(m_items.begin(), it));
+}
+
+void GotoModel::buildTrigrams()
+{
+    QVector<quint64> rowtrigrams;
+    m_trigramindex.clear();
+
+    for(int i = 0; i < m_searchtext.size(); i++)
+    {
+        rowtrigrams.clear();
+        GotoModel::trigrams(m_searchtext[i], &rowtrigrams);
+
+        for(quint64 trigram : rowtrigrams)
+        {
+            QVector<int>& rows = m_trigramindex[trigram];
+
+            if(rows.empty() || (rows.back() != i)) // Rows are visited in order
+                rows.push_back(i);
+        }
+    }
+
+    m_trigramsdirty = false;
+}
 
 QColor GotoModel::itemColor(const REDasm::ListingItem *item) const
 {
@@ -118,7 +356,7 @@ QString GotoModel::itemName(const REDasm::ListingItem *item) const
         const REDasm::Symbol* symbol = document->symbol(item->address);
 
         if(symbol)
-            return S_TO_QS(REDasm::Demangler::demangled(symbol->name));
+            return DEMANGLED(symbol->name);
     }
     else if(item->type == REDasm::ListingItem::TypeItem)
         return S_TO_QS(document->type(item));
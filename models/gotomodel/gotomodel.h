@@ -1,6 +1,8 @@
 #ifndef GOTOMODEL_H
 #define GOTOMODEL_H
 
+#include <QVector>
+#include <QHash>
 #include "../listingitemmodel.h"
 
 class GotoModel : public DisassemblerModel
@@ -9,6 +11,7 @@ class GotoModel : public DisassemblerModel
 
     public:
         explicit GotoModel(QObject *parent = nullptr);
+        ~GotoModel();
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler) override;
 
     public:
@@ -18,10 +21,29 @@ class GotoModel : public DisassemblerModel
         int columnCount(const QModelIndex&) const override;
         int rowCount(const QModelIndex&) const override;
 
+    public:
+        void search(const QString& filter, QVector<bool>* accepted);
+
+    private slots:
+        void loadItems();
+        void onListingChanged(const REDasm::ListingDocumentChanged *ldc);
+
     private:
+        static bool isNavigable(const REDasm::ListingItem* item);
+        static bool fuzzyMatch(const QString& text, const QString& filter);
+        static void trigrams(const QString& s, QVector<quint64>* result);
+        QString searchText(const REDasm::ListingItem* item) const;
+        int insertionRow(const REDasm::ListingItem* item) const;
+        void buildTrigrams();
         QColor itemColor(const REDasm::ListingItem* item) const;
         QString itemName(const REDasm::ListingItem* item) const;
         QString itemType(const REDasm::ListingItem* item) const;
+
+    private:
+        QVector<const REDasm::ListingItem*> m_items;   // Navigable items only, sorted by address
+        QVector<QString> m_searchtext;                 // Lowercase address, name and type per row
+        QHash<quint64, QVector<int> > m_trigramindex;  // Trigram -> rows, rebuilt lazily
+        bool m_trigramsdirty;
 };
 
 #endif // GOTOMODEL_H
@@ -1,8 +1,54 @@
 #include "listingfiltermodel.h"
+#include <QRunnable>
+#include <algorithm>
 
-#define FILTER_MIN_CHARS 2
+#define FILTER_MIN_CHARS  2
+#define FILTER_CHUNK_SIZE 4096 // Index entries per worker
+
+class ListingFilterModel::FilterWorker: public QRunnable
+{
+    public:
+        FilterWorker(const std::shared_ptr<FilterQuery>& query, int chunk, int start, int end, ListingFilterModel* filtermodel): m_query(query), m_filtermodel(filtermodel), m_chunk(chunk), m_start(start), m_end(end) { }
+
+        void run() override
+        {
+            const FilterQuery* query = m_query.get();
+            QVector<int> matches;
+
+            for(int i = m_start; i < m_end; i++)
+            {
+                if(query->cancelled)
+                    return;
+
+                int idx = query->candidates.empty() ? i : query->candidates.at(i);
+
+                if(!query->index.at(idx).text.contains(query->filter))
+                    continue;
+
+                matches.push_back(idx);
+            }
+
+            if(query->cancelled)
+                return;
+
+            QMetaObject::invokeMethod(m_filtermodel, "onChunkFiltered", Qt::QueuedConnection,
+                                      Q_ARG(u64, query->generation), Q_ARG(int, m_chunk), Q_ARG(QVector<int>, matches));
+        }
+
+    private:
+        std::shared_ptr<FilterQuery> m_query;
+        ListingFilterModel* m_filtermodel;
+        int m_chunk, m_start, m_end;
+};
+
+ListingFilterModel::ListingFilterModel(QObject *parent) : QIdentityProxyModel(parent), m_nextchunk(0), m_chunkcount(0), m_generation(0) { }
+
+ListingFilterModel::~ListingFilterModel()
+{
+    this->cancelFiltering();
+    m_threadpool.waitForDone();
+}
 
-ListingFilterModel::ListingFilterModel(QObject *parent) : QIdentityProxyModel(parent) { }
 const QString &ListingFilterModel::filter() const { return m_filterstring; }
 const REDasm::ListingItem *ListingFilterModel::item(const QModelIndex &index) const { return static_cast<ListingItemModel*>(this->sourceModel())->item(this->mapToSource(index));  }
 void ListingFilterModel::setDisassembler(const REDasm::DisassemblerPtr& disassembler) { static_cast<ListingItemModel*>(this->sourceModel())->setDisassembler(disassembler); }
@@ -25,6 +71,30 @@ void ListingFilterModel::clearFilter()
     this->updateFiltering();
 }
 
+void ListingFilterModel::setSourceModel(QAbstractItemModel *sourcemodel)
+{
+    QAbstractItemModel* oldsourcemodel = this->sourceModel();
+
+    if(oldsourcemodel)
+    {
+        disconnect(oldsourcemodel, &QAbstractItemModel::modelReset, this, &ListingFilterModel::buildIndex);
+        disconnect(oldsourcemodel, &QAbstractItemModel::rowsInserted, this, &ListingFilterModel::onRowsInserted);
+        disconnect(oldsourcemodel, &QAbstractItemModel::rowsRemoved, this, &ListingFilterModel::onRowsRemoved);
+        disconnect(oldsourcemodel, &QAbstractItemModel::dataChanged, this, &ListingFilterModel::onDataChanged);
+    }
+
+    QIdentityProxyModel::setSourceModel(sourcemodel);
+    this->buildIndex();
+
+    if(!sourcemodel)
+        return;
+
+    connect(sourcemodel, &QAbstractItemModel::modelReset, this, &ListingFilterModel::buildIndex);
+    connect(sourcemodel, &QAbstractItemModel::rowsInserted, this, &ListingFilterModel::onRowsInserted);
+    connect(sourcemodel, &QAbstractItemModel::rowsRemoved, this, &ListingFilterModel::onRowsRemoved);
+    connect(sourcemodel, &QAbstractItemModel::dataChanged, this, &ListingFilterModel::onDataChanged);
+}
+
 int ListingFilterModel::rowCount(const QModelIndex& parent) const
 {
     if(!this->canFilter())
@@ -38,7 +108,7 @@ QModelIndex ListingFilterModel::index(int row, int column, const QModelIndex&) c
     if(!this->canFilter())
         return QIdentityProxyModel::index(row, column);
 
-    if(m_filtereditems.empty())
+    if((row < 0) || (row >= m_filtereditems.size()))
         return QModelIndex();
 
     return this->createIndex(row, column);
@@ -55,12 +125,12 @@ QModelIndex ListingFilterModel::mapFromSource(const QModelIndex &sourceindex) co
     if(!location.valid)
         return QModelIndex();
 
-    size_t idx = m_filtereditems.indexOf(location);
+    auto it = std::lower_bound(m_filtereditems.begin(), m_filtereditems.end(), static_cast<address_t>(location)); // Results follow source order
 
-    if(idx == REDasm::npos)
+    if((it == m_filtereditems.end()) || (*it != location))
         return QModelIndex();
 
-    return this->index(idx, sourceindex.column());
+    return this->index(static_cast<int>(std::distance(m_filtereditems.begin(), it)), sourceindex.column());
 }
 
 QModelIndex ListingFilterModel::mapToSource(const QModelIndex &proxyindex) const
@@ -69,7 +139,7 @@ QModelIndex ListingFilterModel::mapToSource(const QModelIndex &proxyindex) const
         return QIdentityProxyModel::mapToSource(proxyindex);
 
     ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
-    size_t idx = listingitemmodel->m_items.indexOf(m_filtereditems[proxyindex.row()]);
+    size_t idx = listingitemmodel->m_items->indexOf(m_filtereditems[proxyindex.row()]);
 
     if(idx == REDasm::npos)
         return QModelIndex();
@@ -77,32 +147,227 @@ QModelIndex ListingFilterModel::mapToSource(const QModelIndex &proxyindex) const
     return listingitemmodel->index(idx, proxyindex.column());
 }
 
-void ListingFilterModel::updateFiltering()
+void ListingFilterModel::onChunkFiltered(u64 generation, int chunk, const QVector<int> &matches)
 {
-    this->beginResetModel();
-    m_filtereditems.clear();
+    if(!m_query || (m_query->generation != generation))
+        return;
 
-    if(this->canFilter())
+    m_pendingchunks[chunk] = matches;
+
+    while(m_pendingchunks.contains(m_nextchunk)) // Merge in source order
     {
-        ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
+        QVector<int> chunkmatches = m_pendingchunks.take(m_nextchunk++);
+        QList<address_t> addresses;
 
-        for(int i = 0; i < listingitemmodel->rowCount(); i++)
+        for(int idx : chunkmatches)
         {
-            for(int j = 0; j < listingitemmodel->columnCount(); j++)
-            {
-                QModelIndex index = listingitemmodel->index(i, j);
-                QVariant data = listingitemmodel->data(index);
+            address_t address = m_query->index.at(idx).address;
+            int current = this->indexOf(address);
 
-                if((data.type() != QVariant::String) || (data.toString().indexOf(m_filterstring, 0, Qt::CaseInsensitive) == -1))
-                    continue;
+            if((current != -1) && m_index.at(current).text.contains(m_query->filter)) // Skip rows removed or changed while filtering
+                addresses.push_back(address);
+        }
 
-                m_filtereditems.push_back(listingitemmodel->address(index));
-                break;
-            }
+        if(addresses.empty())
+            continue;
+
+        if(!m_filtereditems.empty() && (m_filtereditems.back() >= addresses.front())) // Rows inserted meanwhile are already there
+        {
+            for(address_t address : addresses)
+                this->insertMatch(address);
+
+            continue;
         }
+
+        int row = m_filtereditems.size();
+        this->beginInsertRows(QModelIndex(), row, row + addresses.size() - 1);
+        m_filtereditems.append(addresses);
+        this->endInsertRows();
     }
 
+    if(m_nextchunk == m_chunkcount)
+        m_query->index.clear();
+}
+
+void ListingFilterModel::onRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    m_index.insert(first, (last - first) + 1, IndexEntry());
+
+    for(int i = first; i <= last; i++)
+    {
+        m_index[i] = this->indexEntry(i);
+
+        if(m_query && m_index[i].text.contains(m_query->filter)) // Running queries scan a snapshot without these rows
+            this->insertMatch(m_index[i].address);
+    }
+}
+
+void ListingFilterModel::onRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    if(m_query)
+    {
+        for(int i = first; (i <= last) && (i < m_index.size()); i++)
+            this->removeMatch(m_index[i].address);
+    }
+
+    m_index.remove(first, std::min((last - first) + 1, m_index.size() - first));
+}
+
+void ListingFilterModel::onDataChanged(const QModelIndex& topleft, const QModelIndex& bottomright)
+{
+    if(topleft.parent().isValid())
+        return;
+
+    for(int i = topleft.row(); (i <= bottomright.row()) && (i < m_index.size()); i++)
+    {
+        m_index[i] = this->indexEntry(i);
+
+        if(!m_query)
+            continue;
+
+        if(m_index[i].text.contains(m_query->filter))
+            this->insertMatch(m_index[i].address);
+        else
+            this->removeMatch(m_index[i].address);
+    }
+}
+
+void ListingFilterModel::updateFiltering()
+{
+    QString filter = m_filterstring.toLower();
+    bool narrow = this->canNarrow(filter);
+    QVector<int> candidates;
+
+    if(narrow)
+    {
+        candidates.reserve(m_filtereditems.size());
+
+        for(address_t address : m_filtereditems)
+        {
+            int idx = this->indexOf(address);
+
+            if(idx != -1)
+                candidates.push_back(idx);
+        }
+    }
+
+    this->cancelFiltering();
+    this->beginResetModel();
+    m_filtereditems.clear();
     this->endResetModel();
+
+    if(!this->canFilter())
+        return;
+
+    m_query = std::make_shared<FilterQuery>();
+    m_query->index = m_index;
+    m_query->candidates = candidates;
+    m_query->filter = filter;
+    m_query->generation = ++m_generation;
+    m_query->cancelled = false;
+
+    int count = narrow ? candidates.size() : m_index.size();
+    m_chunkcount = (count + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+
+    for(int i = 0; i < m_chunkcount; i++)
+        m_threadpool.start(new FilterWorker(m_query, i, i * FILTER_CHUNK_SIZE, std::min(count, (i + 1) * FILTER_CHUNK_SIZE), this));
+}
+
+void ListingFilterModel::cancelFiltering()
+{
+    if(m_query)
+        m_query->cancelled = true;
+
+    m_query.reset();
+    m_pendingchunks.clear();
+    m_nextchunk = m_chunkcount = 0;
+}
+
+void ListingFilterModel::buildIndex() // Kept in sync with the source, so typing never waits for it
+{
+    m_index.clear();
+
+    ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
+
+    if(!listingitemmodel)
+        return;
+
+    m_index.reserve(listingitemmodel->rowCount());
+
+    for(int i = 0; i < listingitemmodel->rowCount(); i++)
+        m_index.push_back(this->indexEntry(i));
+}
+
+void ListingFilterModel::insertMatch(address_t address)
+{
+    auto it = std::lower_bound(m_filtereditems.begin(), m_filtereditems.end(), address);
+
+    if((it != m_filtereditems.end()) && (*it == address))
+        return;
+
+    int row = static_cast<int>(std::distance(m_filtereditems.begin(), it));
+    this->beginInsertRows(QModelIndex(), row, row);
+    m_filtereditems.insert(row, address);
+    this->endInsertRows();
+}
+
+void ListingFilterModel::removeMatch(address_t address)
+{
+    auto it = std::lower_bound(m_filtereditems.begin(), m_filtereditems.end(), address);
+
+    if((it == m_filtereditems.end()) || (*it != address))
+        return;
+
+    int row = static_cast<int>(std::distance(m_filtereditems.begin(), it));
+    this->beginRemoveRows(QModelIndex(), row, row);
+    m_filtereditems.removeAt(row);
+    this->endRemoveRows();
+}
+
+int ListingFilterModel::indexOf(address_t address) const
+{
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), address, [](const IndexEntry& entry, address_t address) { return entry.address < address; });
+
+    if((it == m_index.end()) || (it->address != address))
+        return -1;
+
+    return static_cast<int>(std::distance(m_index.begin(), it));
+}
+
+ListingFilterModel::IndexEntry ListingFilterModel::indexEntry(int row) const
+{
+    ListingItemModel* listingitemmodel = reinterpret_cast<ListingItemModel*>(this->sourceModel());
+    IndexEntry entry;
+
+    for(int j = 0; j < listingitemmodel->columnCount(); j++)
+    {
+        QModelIndex index = listingitemmodel->index(row, j);
+        QVariant data = listingitemmodel->data(index);
+
+        if(data.type() != QVariant::String)
+            continue;
+
+        entry.text += data.toString().toLower() + QChar('\n'); // Keep matches inside a single column
+    }
+
+    entry.address = listingitemmodel->address(listingitemmodel->index(row, 0));
+    return entry;
+}
+
+bool ListingFilterModel::canNarrow(const QString &filter) const
+{
+    // A query that extends a completed one can only match a subset of its results,
+    // rows changed since then have been matched against it as they arrived
+    if(!m_query || (m_nextchunk < m_chunkcount))
+        return false;
+
+    return filter.contains(m_query->filter);
 }
 
 bool ListingFilterModel::canFilter() const { return m_filterstring.length() >= FILTER_MIN_CHARS; }
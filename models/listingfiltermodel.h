@@ -2,14 +2,34 @@
 #define LISTINGFILTERMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QThreadPool>
+#include <QVector>
+#include <QHash>
+#include <atomic>
+#include <memory>
 #include "listingitemmodel.h"
 
 class ListingFilterModel : public QIdentityProxyModel
 {
     Q_OBJECT
 
+    private:
+        struct IndexEntry { address_t address; QString text; }; // Lowercase display strings, one entry per source row
+        typedef QVector<IndexEntry> SearchIndex;
+
+        struct FilterQuery {
+            SearchIndex index;      // Shared snapshot, read-only for workers, released when the query completes
+            QVector<int> candidates; // Index positions to scan, empty means all entries
+            QString filter;
+            u64 generation;
+            std::atomic_bool cancelled;
+        };
+
+        class FilterWorker;
+
     public:
         explicit ListingFilterModel(QObject *parent = nullptr);
+        ~ListingFilterModel();
         const QString& filter() const;
         const REDasm::ListingItem* item(const QModelIndex& index) const;
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
@@ -17,13 +37,27 @@ class ListingFilterModel : public QIdentityProxyModel
         void clearFilter();
 
     public:
+        void setSourceModel(QAbstractItemModel* sourcemodel) override;
         int rowCount(const QModelIndex& parent = QModelIndex()) const override;
         QModelIndex index(int row, int column, const QModelIndex& = QModelIndex()) const override;
         QModelIndex mapFromSource(const QModelIndex& sourceindex) const override;
         QModelIndex mapToSource(const QModelIndex& proxyindex) const override;
 
+    private slots:
+        void onChunkFiltered(u64 generation, int chunk, const QVector<int>& matches);
+        void buildIndex();
+        void onRowsInserted(const QModelIndex& parent, int first, int last);
+        void onRowsRemoved(const QModelIndex& parent, int first, int last);
+        void onDataChanged(const QModelIndex& topleft, const QModelIndex& bottomright);
+
     private:
         void updateFiltering();
+        void cancelFiltering();
+        void insertMatch(address_t address);
+        void removeMatch(address_t address);
+        int indexOf(address_t address) const;
+        IndexEntry indexEntry(int row) const;
+        bool canNarrow(const QString& filter) const;
         bool canFilter() const;
 
     public:
@@ -31,8 +65,14 @@ class ListingFilterModel : public QIdentityProxyModel
         template<typename T> static ListingFilterModel* createFilter(size_t filter, QObject* parent);
 
     private:
-        QList<address_t> m_filtereditems;
+        QThreadPool m_threadpool;
+        SearchIndex m_index;
+        std::shared_ptr<FilterQuery> m_query;
+        QHash<int, QVector<int> > m_pendingchunks;
+        QList<address_t> m_filtereditems; // Sorted like the source rows
         QString m_filterstring;
+        int m_nextchunk, m_chunkcount;
+        u64 m_generation;
 };
 
 template<typename T> ListingFilterModel *ListingFilterModel::createFilter(QObject *parent)
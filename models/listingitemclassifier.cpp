@@ -0,0 +1,214 @@
+#include "listingitemclassifier.h"
+#include "listingitemmodel.h"
+#include <algorithm>
+
+#define CATEGORY_BIT(c) (1u << (c))
+
+QHash<REDasm::DisassemblerAPI*, std::weak_ptr<ListingItemClassifier> > ListingItemClassifier::m_classifiers;
+
+ListingItemClassifier::ListingItemClassifier(const REDasm::DisassemblerPtr &disassembler): QObject(), m_disassembler(disassembler)
+{
+    this->loadItems();
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, std::bind(&ListingItemClassifier::onListingChanged, this, std::placeholders::_1));
+
+    EVENT_CONNECT(m_disassembler, busyChanged, this, [&]() {
+        if(m_disassembler->busy())
+            return;
+
+        QMetaObject::invokeMethod(this, "loadItems", Qt::QueuedConnection);
+    });
+}
+
+ListingItemClassifier::~ListingItemClassifier()
+{
+    EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+    EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+    m_classifiers.remove(m_disassembler.get());
+}
+
+const ListingItemClassifier::Rows *ListingItemClassifier::rows(ListingItemClassifier::Category category) const { return &m_rows[category]; }
+
+void ListingItemClassifier::attach(ListingItemModel *model)
+{
+    model->beginResetModel();
+    m_models.push_back(model);
+    model->m_items = &m_rows[model->category()];
+    model->endResetModel();
+}
+
+void ListingItemClassifier::detach(ListingItemModel *model) { m_models.removeAll(model); }
+
+std::shared_ptr<ListingItemClassifier> ListingItemClassifier::get(const REDasm::DisassemblerPtr &disassembler)
+{
+    std::shared_ptr<ListingItemClassifier> classifier = m_classifiers.value(disassembler.get()).lock();
+
+    if(classifier)
+        return classifier;
+
+    classifier = std::make_shared<ListingItemClassifier>(disassembler);
+    m_classifiers[disassembler.get()] = classifier;
+    return classifier;
+}
+
+void ListingItemClassifier::loadItems()
+{
+    auto& document = m_disassembler->document();
+    std::vector<address_t> items[CategoryCount];
+
+    for(auto it = document->begin(); it != document->end(); it++) // Classify each item once for every category
+    {
+        size_t categories = this->classify(it->get());
+
+        for(size_t i = 0; categories && (i < CategoryCount); i++)
+        {
+            if(categories & CATEGORY_BIT(i))
+                items[i].push_back((*it)->address);
+        }
+    }
+
+    for(ListingItemModel* model : m_models)
+        model->beginResetModel();
+
+    for(size_t i = 0; i < CategoryCount; i++)
+    {
+        std::sort(items[i].begin(), items[i].end());
+        items[i].erase(std::unique(items[i].begin(), items[i].end()), items[i].end());
+
+        m_rows[i] = Rows();
+
+        for(address_t address : items[i]) // Already sorted: every insertion lands at the end
+            m_rows[i].insert(address);
+    }
+
+    for(ListingItemModel* model : m_models)
+        model->endResetModel();
+}
+
+void ListingItemClassifier::onListingChanged(const REDasm::ListingDocumentChanged *ldc)
+{
+    if(m_disassembler->busy()) // Picked up in one pass by loadItems() when analysis ends
+        return;
+
+    if(ldc->isRemoved())
+    {
+        size_t categories = this->classifyRemoved(ldc->item);
+
+        for(size_t i = 0; categories && (i < CategoryCount); i++)
+        {
+            if(categories & CATEGORY_BIT(i))
+                this->removeRow(static_cast<Category>(i), ldc->item->address);
+        }
+    }
+    else if(ldc->isInserted())
+    {
+        size_t categories = this->classify(ldc->item);
+
+        for(size_t i = 0; categories && (i < CategoryCount); i++)
+        {
+            if(categories & CATEGORY_BIT(i))
+                this->insertRow(static_cast<Category>(i), ldc->item->address);
+        }
+    }
+}
+
+void ListingItemClassifier::insertRow(ListingItemClassifier::Category category, address_t address)
+{
+    int idx = static_cast<int>(m_rows[category].insertionIndex(address));
+
+    for(ListingItemModel* model : m_models)
+    {
+        if(model->category() == category)
+            model->beginInsertRows(QModelIndex(), idx, idx);
+    }
+
+    m_rows[category].insert(address);
+
+    for(ListingItemModel* model : m_models)
+    {
+        if(model->category() == category)
+            model->endInsertRows();
+    }
+}
+
+void ListingItemClassifier::removeRow(ListingItemClassifier::Category category, address_t address)
+{
+    size_t idx = m_rows[category].indexOf(address);
+
+    if(idx == REDasm::npos)
+        return;
+
+    for(ListingItemModel* model : m_models)
+    {
+        if(model->category() == category)
+            model->beginRemoveRows(QModelIndex(), static_cast<int>(idx), static_cast<int>(idx));
+    }
+
+    m_rows[category].eraseAt(idx);
+
+    for(ListingItemModel* model : m_models)
+    {
+        if(model->category() == category)
+            model->endRemoveRows();
+    }
+}
+
+size_t ListingItemClassifier::classify(const REDasm::ListingItem *item) const
+{
+    if(item->is(REDasm::ListingItem::SegmentItem))
+        return CATEGORY_BIT(Segments);
+
+    if(!item->is(REDasm::ListingItem::FunctionItem) && !item->is(REDasm::ListingItem::SymbolItem))
+        return 0;
+
+    size_t categories = item->is(REDasm::ListingItem::FunctionItem) ? CATEGORY_BIT(Functions) : 0;
+    const REDasm::Symbol* symbol = m_disassembler->document()->symbol(item->address); // Single lookup shared by every symbol category
+
+    if(!symbol)
+        return categories;
+
+    if(symbol->is(REDasm::SymbolType::ExportMask))
+        categories |= CATEGORY_BIT(Exports);
+
+    if(item->is(REDasm::ListingItem::SymbolItem))
+    {
+        if(symbol->is(REDasm::SymbolType::ImportMask))
+            categories |= CATEGORY_BIT(Imports);
+
+        if(symbol->is(REDasm::SymbolType::StringMask))
+            categories |= CATEGORY_BIT(Strings);
+    }
+
+    return categories;
+}
+
+size_t ListingItemClassifier::classifyRemoved(const REDasm::ListingItem *item) const
+{
+    // The symbol may be gone already: use the categories this item type can be in
+    auto& document = m_disassembler->document();
+
+    if(item->is(REDasm::ListingItem::SegmentItem))
+        return CATEGORY_BIT(Segments);
+
+    if(item->is(REDasm::ListingItem::FunctionItem))
+    {
+        size_t categories = CATEGORY_BIT(Functions);
+
+        if(document->symbolItem(item->address) == document->end()) // Otherwise the symbol keeps the export
+            categories |= CATEGORY_BIT(Exports);
+
+        return categories;
+    }
+
+    if(item->is(REDasm::ListingItem::SymbolItem))
+    {
+        size_t categories = CATEGORY_BIT(Imports) | CATEGORY_BIT(Strings);
+
+        if(document->functionItem(item->address) == document->end()) // Otherwise the function keeps the export
+            categories |= CATEGORY_BIT(Exports);
+
+        return categories;
+    }
+
+    return 0;
+}
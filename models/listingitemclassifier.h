@@ -0,0 +1,47 @@
+#ifndef LISTINGITEMCLASSIFIER_H
+#define LISTINGITEMCLASSIFIER_H
+
+#include <QObject>
+#include <QHash>
+#include <memory>
+#include <redasm/disassembler/disassemblerapi.h>
+#include <redasm/disassembler/listing/listingdocument.h>
+
+class ListingItemModel;
+
+class ListingItemClassifier : public QObject
+{
+    Q_OBJECT
+
+    public:
+        enum Category { Segments = 0, Functions, Imports, Exports, Strings, CategoryCount };
+        typedef REDasm::sorted_container<address_t> Rows;
+
+    public:
+        explicit ListingItemClassifier(const REDasm::DisassemblerPtr& disassembler);
+        ~ListingItemClassifier();
+        const Rows* rows(Category category) const;
+        void attach(ListingItemModel* model);
+        void detach(ListingItemModel* model);
+
+    public:
+        static std::shared_ptr<ListingItemClassifier> get(const REDasm::DisassemblerPtr& disassembler);
+
+    private slots:
+        void loadItems();
+
+    private:
+        void onListingChanged(const REDasm::ListingDocumentChanged *ldc);
+        void insertRow(Category category, address_t address);
+        void removeRow(Category category, address_t address);
+        size_t classify(const REDasm::ListingItem* item) const;
+        size_t classifyRemoved(const REDasm::ListingItem* item) const;
+
+    private:
+        REDasm::DisassemblerPtr m_disassembler;
+        QList<ListingItemModel*> m_models;
+        Rows m_rows[CategoryCount];
+        static QHash<REDasm::DisassemblerAPI*, std::weak_ptr<ListingItemClassifier> > m_classifiers;
+};
+
+#endif // LISTINGITEMCLASSIFIER_H
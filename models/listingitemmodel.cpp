@@ -1,50 +1,49 @@
 #include "listingitemmodel.h"
 #include <redasm/disassembler/listing/listingdocument.h>
-#include <redasm/support/demangler.h>
 #include <redasm/plugins/loader.h>
 #include "../themeprovider.h"
+#include "../demanglecache.h"
 #include <QColor>
 
-ListingItemModel::ListingItemModel(size_t itemtype, QObject *parent) : DisassemblerModel(parent), m_itemtype(itemtype) { }
+const ListingItemClassifier::Rows ListingItemModel::m_noitems{ };
+
+ListingItemModel::ListingItemModel(size_t itemtype, QObject *parent) : DisassemblerModel(parent), m_items(&ListingItemModel::m_noitems), m_itemtype(itemtype) { }
+
+ListingItemModel::~ListingItemModel()
+{
+    if(m_classifier)
+        m_classifier->detach(this);
+}
 
 void ListingItemModel::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
 {
     DisassemblerModel::setDisassembler(disassembler);
-    auto& document = m_disassembler->document();
-
-    this->beginResetModel();
-
-    for(auto it = document->begin(); it != document->end(); it++)
-    {
-        if(!this->isItemAllowed(it->get()))
-            continue;
-
-        m_items.insert((*it)->address);
-    }
 
-    this->endResetModel();
+    if(m_classifier)
+        m_classifier->detach(this);
 
-    EVENT_CONNECT(document, changed, this, std::bind(&ListingItemModel::onListingChanged, this, std::placeholders::_1));
+    m_classifier = ListingItemClassifier::get(disassembler);
+    m_classifier->attach(this);
 }
 
 const REDasm::ListingItem *ListingItemModel::item(const QModelIndex &index) const
 {
-    if(!index.isValid() || (index.row() >= m_items.size()))
+    if(!index.isValid() || (index.row() >= m_items->size()))
         return nullptr;
 
     auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
     REDasm::ListingDocumentType::const_iterator it = lock->end();
 
     if(m_itemtype == REDasm::ListingItem::SegmentItem)
-        it = lock->segmentItem(m_items[index.row()]);
+        it = lock->segmentItem((*m_items)[index.row()]);
     else if(m_itemtype == REDasm::ListingItem::FunctionItem)
-        it = lock->functionItem(m_items[index.row()]);
+        it = lock->functionItem((*m_items)[index.row()]);
     else
     {
-        it = lock->instructionItem(m_items[index.row()]); // Try to get an instruction
+        it = lock->instructionItem((*m_items)[index.row()]); // Try to get an instruction
 
         if(it == lock->end())
-            it = lock->symbolItem(m_items[index.row()]);  // Try to get an symbol
+            it = lock->symbolItem((*m_items)[index.row()]);  // Try to get an symbol
     }
 
     return (it != lock->end()) ? it->get() : nullptr;
@@ -52,23 +51,23 @@ const REDasm::ListingItem *ListingItemModel::item(const QModelIndex &index) cons
 
 address_location ListingItemModel::address(const QModelIndex &index) const
 {
-    if(!index.isValid() || (index.row() < 0) || (index.row() >= m_items.size()))
+    if(!index.isValid() || (index.row() < 0) || (index.row() >= m_items->size()))
         return REDasm::invalid_location<address_t>();
 
-    return REDasm::make_location(m_items[index.row()]);
+    return REDasm::make_location((*m_items)[index.row()]);
 }
 
 QModelIndex ListingItemModel::index(int row, int column, const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
 
-    if((row < 0) || (row >= m_items.size()))
+    if((row < 0) || (row >= m_items->size()))
         return QModelIndex();
 
     return this->createIndex(row, column);
 }
 
-int ListingItemModel::rowCount(const QModelIndex &) const { return m_items.size(); }
+int ListingItemModel::rowCount(const QModelIndex &) const { return m_items->size(); }
 int ListingItemModel::columnCount(const QModelIndex &) const { return 4; }
 
 QVariant ListingItemModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -97,7 +96,7 @@ QVariant ListingItemModel::data(const QModelIndex &index, int role) const
         return QVariant();
 
     auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
-    const REDasm::Symbol* symbol = lock->symbol(m_items[index.row()]);
+    const REDasm::Symbol* symbol = lock->symbol((*m_items)[index.row()]);
 
     if(!symbol)
         return QVariant();
@@ -114,7 +113,7 @@ QVariant ListingItemModel::data(const QModelIndex &index, int role) const
             else if(symbol->is(REDasm::SymbolType::StringMask))
                 return S_TO_QS(REDasm::quoted(m_disassembler->readString(symbol)));
 
-            return S_TO_QS(REDasm::Demangler::demangled(symbol->name));
+            return DEMANGLED(symbol->name);
         }
 
         if(index.column() == 2)
@@ -147,31 +146,10 @@ QVariant ListingItemModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
-bool ListingItemModel::isItemAllowed(const REDasm::ListingItem *item) const
+ListingItemClassifier::Category ListingItemModel::category() const
 {
-    if(m_itemtype == REDasm::ListingItem::AllItems)
-        return true;
-
-    return m_itemtype == item->type;
-}
-
-void ListingItemModel::onListingChanged(const REDasm::ListingDocumentChanged *ldc)
-{
-    if(!this->isItemAllowed(ldc->item))
-        return;
+    if(m_itemtype == REDasm::ListingItem::SegmentItem)
+        return ListingItemClassifier::Segments;
 
-    if(ldc->isRemoved())
-    {
-        int idx = static_cast<int>(m_items.indexOf(ldc->item->address));
-        this->beginRemoveRows(QModelIndex(), idx, idx);
-        m_items.eraseAt(static_cast<size_t>(idx));
-        this->endRemoveRows();
-    }
-    else if(ldc->isInserted())
-    {
-        int idx = static_cast<int>(m_items.insertionIndex(ldc->item->address));
-        this->beginInsertRows(QModelIndex(), idx, idx);
-        m_items.insert(ldc->item->address);
-        this->endInsertRows();
-    }
+    return ListingItemClassifier::Functions;
 }
@@ -3,6 +3,7 @@
 
 #include <QList>
 #include "disassemblermodel.h"
+#include "listingitemclassifier.h"
 #include <redasm/disassembler/listing/listingdocument.h>
 
 class ListingItemModel : public DisassemblerModel
@@ -11,6 +12,7 @@ class ListingItemModel : public DisassemblerModel
 
     public:
         explicit ListingItemModel(size_t itemtype, QObject *parent = nullptr);
+        ~ListingItemModel();
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler) override;
         const REDasm::ListingItem* item(const QModelIndex& index) const;
         address_location address(const QModelIndex& index) const;
@@ -23,15 +25,17 @@ class ListingItemModel : public DisassemblerModel
         QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
     protected:
-        virtual bool isItemAllowed(const REDasm::ListingItem *item) const;
-
-    private slots:
-        void onListingChanged(const REDasm::ListingDocumentChanged *ldc);
+        virtual ListingItemClassifier::Category category() const;
 
     private:
-        REDasm::sorted_container<address_t> m_items;
+        std::shared_ptr<ListingItemClassifier> m_classifier;
+        const ListingItemClassifier::Rows* m_items; // Shared with every model of the same category
         size_t m_itemtype;
 
+    private:
+        static const ListingItemClassifier::Rows m_noitems;
+
+    friend class ListingItemClassifier;
     friend class ListingFilterModel;
 };
 
@@ -1,5 +1,5 @@
 #include "signaturesmodel.h"
-#include <redasm/support/demangler.h>
+#include "../../demanglecache.h"
 
 SignaturesModel::SignaturesModel(QObject *parent): QAbstractListModel(parent), m_signaturedb(nullptr) { }
 
@@ -18,7 +18,7 @@ QVariant SignaturesModel::data(const QModelIndex &index, int role) const
     if(index.column() == 0)
     {
         const auto& signature = m_signaturedb->at(index.row());
-        return QString::fromStdString(REDasm::Demangler::demangled(signature["name"]));
+        return DEMANGLED(signature["name"]);
     }
     if(index.column() == 1)
         return QString::fromStdString(m_signaturedb->assembler());
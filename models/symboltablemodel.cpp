@@ -3,11 +3,12 @@
 SymbolTableModel::SymbolTableModel(size_t itemtype, QObject *parent) : ListingItemModel(itemtype, parent), m_symboltype(REDasm::SymbolType::None) { }
 void SymbolTableModel::setSymbolType(REDasm::SymbolType type) { m_symboltype = type; }
 
-bool SymbolTableModel::isItemAllowed(const REDasm::ListingItem *item) const
+ListingItemClassifier::Category SymbolTableModel::category() const
 {
-    if(!ListingItemModel::isItemAllowed(item) || (!item->is(REDasm::ListingItem::FunctionItem) && !item->is(REDasm::ListingItem::SymbolItem)))
-        return false;
+    if(m_symboltype == REDasm::SymbolType::ImportMask)
+        return ListingItemClassifier::Imports;
+    if(m_symboltype == REDasm::SymbolType::ExportMask)
+        return ListingItemClassifier::Exports;
 
-    const REDasm::Symbol* symbol = m_disassembler->document()->symbol(item->address);
-    return symbol && symbol->is(m_symboltype);
+    return ListingItemClassifier::Strings;
 }
@@ -12,7 +12,7 @@ class SymbolTableModel : public ListingItemModel
         void setSymbolType(REDasm::SymbolType type);
 
     protected:
-        virtual bool isItemAllowed(const REDasm::ListingItem *item) const;
+        ListingItemClassifier::Category category() const override;
 
     private:
         REDasm::SymbolType m_symboltype;
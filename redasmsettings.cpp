@@ -4,6 +4,8 @@
 
 #define CURRENT_WINDOW_GEOMETRY "window_geometry_2"
 #define CURRENT_WINDOW_STATE    "window_state_2"
+#define GRAPH_DETAIL_SCALE      0.45 // Below this zoom level blocks are drawn as summaries
+#define GRAPH_THUMBNAIL_SCALE   0.12 // Below this zoom level the whole graph is a cached pixmap
 
 QByteArray REDasmSettings::m_defaultstate;
 
@@ -60,6 +62,9 @@ int REDasmSettings::currentFontSize() const
     return this->value("selected_font_size", size).toInt();
 }
 
+qreal REDasmSettings::graphDetailScale() const { return this->value("graph_detail_scale", GRAPH_DETAIL_SCALE).toReal(); }
+qreal REDasmSettings::graphThumbnailScale() const { return this->value("graph_thumbnail_scale", GRAPH_THUMBNAIL_SCALE).toReal(); }
+
 void REDasmSettings::changeTheme(const QString& theme) { this->setValue("selected_theme", theme.toLower()); }
 void REDasmSettings::changeFont(const QFont &font) { this->setValue("selected_font", font);  }
 void REDasmSettings::changeFontSize(int size) { this->setValue("selected_font_size", size); }
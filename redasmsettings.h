@@ -16,6 +16,8 @@ class REDasmSettings : public QSettings
         QString currentTheme() const;
         QFont currentFont() const;
         int currentFontSize() const;
+        qreal graphDetailScale() const;
+        qreal graphThumbnailScale() const;
         bool restoreState(QMainWindow* mainwindow);
         void defaultState(QMainWindow* mainwindow);
         void saveState(const QMainWindow* mainwindow);
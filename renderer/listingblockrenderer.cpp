@@ -0,0 +1,62 @@
+#include "listingblockrenderer.h"
+#include "../redasmsettings.h"
+#include <QPainter>
+
+ListingBlockRenderer::ListingBlockRenderer(REDasm::DisassemblerAPI *disassembler): ListingRendererCommon(disassembler), m_textcache(REDasmSettings::font())
+{
+    this->setFlags(ListingBlockRenderer::HideSegmentName);
+}
+
+void ListingBlockRenderer::setRange(size_t start, size_t count)
+{
+    this->setFirstVisibleLine(start);
+    m_lines.clear();
+    m_lines.resize(static_cast<int>(count));
+    this->update();
+}
+
+void ListingBlockRenderer::updateLine(size_t line)
+{
+    if((line < m_firstline) || (line >= (m_firstline + m_lines.size())))
+        return;
+
+    this->render(line, 1, nullptr);
+}
+
+void ListingBlockRenderer::update()
+{
+    m_maxwidth = 0;
+    this->render(m_firstline, m_lines.size(), nullptr);
+}
+
+void ListingBlockRenderer::clear() // Cached lines of another block never hit again
+{
+    m_lines.clear();
+    m_textcache.clear();
+    m_maxwidth = 0;
+    this->invalidateIndex();
+}
+
+void ListingBlockRenderer::paint(QPainter *painter)
+{
+    QSizeF sz = this->size();
+
+    painter->save();
+    painter->setClipRect(QRectF(QPointF(0, 0), sz), Qt::IntersectClip); // Highlighted lines span the block only
+
+    for(int i = 0; i < m_lines.size(); i++)
+        ListingRendererCommon::renderText(painter, &m_lines[i], 0, i * m_fontmetrics.height(), m_fontmetrics);
+
+    painter->restore();
+}
+
+QSizeF ListingBlockRenderer::size() const { return QSizeF(m_maxwidth, m_lines.size() * m_fontmetrics.height()); }
+
+void ListingBlockRenderer::renderLine(const REDasm::RendererLine &rl)
+{
+    const ListingTextCache::Line* cl = m_textcache.line(rl);
+    this->validateIndex(rl);
+
+    m_lines[static_cast<int>(rl.documentindex - m_firstline)] = *cl; // Runs are implicitly shared
+    m_maxwidth = std::max(m_maxwidth, cl->width);
+}
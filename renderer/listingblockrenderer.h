@@ -0,0 +1,29 @@
+#ifndef LISTINGBLOCKRENDERER_H
+#define LISTINGBLOCKRENDERER_H
+
+#include <QVector>
+#include <QSizeF>
+#include "listingrenderercommon.h"
+#include "listingtextcache.h"
+
+class ListingBlockRenderer: public ListingRendererCommon
+{
+    public:
+        ListingBlockRenderer(REDasm::DisassemblerAPI* disassembler);
+        virtual ~ListingBlockRenderer() = default;
+        void setRange(size_t start, size_t count);
+        void updateLine(size_t line);
+        void update();
+        void clear();
+        void paint(QPainter* painter);
+        QSizeF size() const;
+
+    protected:
+        void renderLine(const REDasm::RendererLine& rl) override;
+
+    private:
+        QVector<ListingTextCache::Line> m_lines; // Shaped lines of the block, painted as they are
+        ListingTextCache m_textcache;
+};
+
+#endif // LISTINGBLOCKRENDERER_H
@@ -13,5 +13,6 @@ void ListingDocumentRenderer::renderLine(const REDasm::RendererLine &rl)
     QTextCursor textcursor(textdocument);
 
     m_maxwidth = std::max(m_maxwidth, m_fontmetrics.boundingRect(QString::fromStdString(rl.text)).width());
+    this->validateIndex(rl);
     this->insertText(rl, &textcursor);
 }
@@ -5,10 +5,18 @@
 #include <QRegularExpression>
 #include <QTextCharFormat>
 #include <QTextDocument>
+#include <QFontInfo>
 #include <QPalette>
 #include <QPainter>
 
-ListingRendererCommon::ListingRendererCommon(REDasm::DisassemblerAPI *disassembler): REDasm::ListingRenderer(disassembler), m_fontmetrics(REDasmSettings::font()), m_maxwidth(0), m_firstline(0) { }
+ListingRendererCommon::ListingRendererCommon(REDasm::DisassemblerAPI *disassembler): REDasm::ListingRenderer(disassembler), m_fontmetrics(REDasmSettings::font()), m_lineindex(LINE_INDEX_CACHE_SIZE), m_maxwidth(0), m_firstline(0)
+{
+    QFont font = REDasmSettings::font();
+
+    m_advance = m_fontmetrics.width(' ');
+    m_fixedpitch = QFontInfo(font).fixedPitch() && qFuzzyCompare(m_fontmetrics.width('i'), m_fontmetrics.width('W'));
+    m_seekstyle = THEME_STYLE_ID("seek");
+}
 
 void ListingRendererCommon::moveTo(const QPointF &pos)
 {
@@ -26,38 +34,41 @@ REDasm::ListingCursor::Position ListingRendererCommon::hitTest(const QPointF &po
 {
     REDasm::ListingCursor::Position cp;
     cp.first = std::min(static_cast<size_t>(m_firstline + std::floor(pos.y() / m_fontmetrics.height())), m_document->lastLine());
-    cp.second = std::numeric_limits<size_t>::max();
+    cp.second = 0;
 
-    REDasm::RendererLine rl(true);
+    const LineIndex* li = this->lineIndex(cp.first);
 
-    if(!this->getRendererLine(cp.first, rl))
-        cp.second = 0;
+    if(!li || li->text.empty())
+        return cp;
 
-    std::string s = rl.text;
-    qreal x = 0;
+    size_t lastcolumn = li->text.length() - 1;
 
-    for(size_t i = 0; i < s.length(); i++)
+    if(pos.x() <= 0)
+        return cp;
+
+    if(m_fixedpitch)
     {
-        qreal w = m_fontmetrics.width(s[i]);
+        cp.second = std::min(static_cast<size_t>(pos.x() / m_advance), lastcolumn);
+        return cp;
+    }
 
-        if(x >= pos.x())
-        {
-            cp.second = i - 1;
-            break;
-        }
+    qreal x = 0;
 
-        x += w;
-    }
+    for(size_t i = 0; i < li->text.length(); i++)
+    {
+        x += m_fontmetrics.width(li->text[i]);
 
-    if(cp.second == std::numeric_limits<size_t>::max())
-        cp.second = s.length() - 1;
+        if(x > pos.x())
+            return { cp.first, i };
+    }
 
+    cp.second = lastcolumn;
     return cp;
 }
 
 std::string ListingRendererCommon::getWordFromPos(const QPointF &pos, REDasm::ListingRenderer::Range* wordpos)
 {
-    REDasm::ListingCursor::Position cp = this->hitTest(pos);
+    REDasm::ListingCursor::Position cp = this->hitTest(pos); // Only the x -> column mapping is cached
     return this->wordFromPosition(cp, wordpos);
 }
 
@@ -81,10 +92,38 @@ REDasm::ListingRenderer::Range ListingRendererCommon::wordHitTest(const QPointF
     return wordpos;
 }
 
+void ListingRendererCommon::invalidateIndex(size_t line) { m_lineindex.remove(line); }
+void ListingRendererCommon::invalidateIndex() { m_lineindex.clear(); }
 void ListingRendererCommon::setFirstVisibleLine(size_t line) { m_firstline = line; }
 const QFontMetricsF ListingRendererCommon::fontMetrics() const { return m_fontmetrics; }
 qreal ListingRendererCommon::maxWidth() const { return m_maxwidth; }
 
+void ListingRendererCommon::validateIndex(const REDasm::RendererLine &rl)
+{
+    const LineIndex* li = m_lineindex.object(rl.documentindex);
+
+    if(li && (li->text != rl.text)) // Line changed since it was indexed
+        m_lineindex.remove(rl.documentindex);
+}
+
+const ListingRendererCommon::LineIndex *ListingRendererCommon::lineIndex(size_t line)
+{
+    LineIndex* li = m_lineindex.object(line);
+
+    if(li)
+        return li;
+
+    REDasm::RendererLine rl(true);
+
+    if(!this->getRendererLine(line, rl))
+        return nullptr;
+
+    li = new LineIndex();
+    li->text = rl.text;
+    m_lineindex.insert(line, li); // Takes ownership
+    return li;
+}
+
 void ListingRendererCommon::insertText(const REDasm::RendererLine &rl, QTextCursor *textcursor)
 {
     if(rl.index > 0)
@@ -98,22 +137,10 @@ void ListingRendererCommon::insertText(const REDasm::RendererLine &rl, QTextCurs
         QTextCharFormat charformat;
 
         if(!rf.fgstyle.empty())
-        {
-            if((rf.fgstyle == "cursor_fg") || (rf.fgstyle == "selection_fg"))
-                charformat.setForeground(qApp->palette().color(QPalette::HighlightedText));
-            else
-                charformat.setForeground(THEME_VALUE(QString::fromStdString(rf.fgstyle)));
-        }
+            charformat.setForeground(THEME_STYLE(THEME_STYLE_ID(rf.fgstyle)).brush);
 
         if(!rf.bgstyle.empty())
-        {
-            if(rf.bgstyle == "cursor_bg")
-                charformat.setBackground(qApp->palette().color(QPalette::WindowText));
-            else if(rf.bgstyle == "selection_bg")
-                charformat.setBackground(qApp->palette().color(QPalette::Highlight));
-            else
-                charformat.setBackground(THEME_VALUE(QString::fromStdString(rf.bgstyle)));
-        }
+            charformat.setBackground(THEME_STYLE(THEME_STYLE_ID(rf.bgstyle)).brush);
 
         textcursor->insertText(QString::fromStdString(rl.formatText(rf)), charformat);
     }
@@ -122,46 +149,29 @@ void ListingRendererCommon::insertText(const REDasm::RendererLine &rl, QTextCurs
         return;
 
     QTextBlockFormat blockformat;
-    blockformat.setBackground(THEME_VALUE("seek"));
+    blockformat.setBackground(THEME_STYLE(m_seekstyle).brush);
     textcursor->setBlockFormat(blockformat);
 }
 
-void ListingRendererCommon::renderText(const REDasm::RendererLine &rl, float x, float y, const QFontMetricsF& fm)
+void ListingRendererCommon::renderText(QPainter* painter, const ListingTextCache::Line* cl, qreal x, qreal y, const QFontMetricsF& fm)
 {
-    QPainter* painter = reinterpret_cast<QPainter*>(rl.userdata);
+    QRectF cliprect = painter->hasClipping() ? painter->clipBoundingRect() : QRectF(painter->viewport());
 
-    if(rl.highlighted)
-    {
-        QRect vpr = painter->viewport();
-        painter->fillRect(0, y, vpr.width(), fm.height(), THEME_VALUE("seek"));
-    }
+    if(cl->highlighted)
+        painter->fillRect(QRectF(cliprect.left(), y, cliprect.width(), fm.height()), THEME_STYLE(m_seekstyle).brush);
 
-    for(const REDasm::RendererFormat& rf : rl.formats)
+    for(const ListingTextCache::Run& run : cl->runs)
     {
-        if(!rf.fgstyle.empty())
-        {
-            if((rf.fgstyle == "cursor_fg") || (rf.fgstyle == "selection_fg"))
-                painter->setPen(qApp->palette().color(QPalette::HighlightedText));
-            else
-                painter->setPen(THEME_VALUE(QString::fromStdString(rf.fgstyle)));
-        }
-        else
-            painter->setPen(qApp->palette().color(QPalette::WindowText));
-
-        QString chunk = QString::fromStdString(rl.formatText(rf));
-        QRectF chunkrect = painter->boundingRect(QRectF(x, y, fm.width(chunk), fm.height()), Qt::TextIncludeTrailingSpaces, chunk);
+        if((x + run.x + run.width) < cliprect.left()) // Scrolled out on the left
+            continue;
 
-        if(!rf.bgstyle.empty())
-        {
-            if(rf.bgstyle == "cursor_bg")
-                painter->fillRect(chunkrect, qApp->palette().color(QPalette::WindowText));
-            else if(rf.bgstyle == "selection_bg")
-                painter->fillRect(chunkrect, qApp->palette().color(QPalette::Highlight));
-            else
-                painter->fillRect(chunkrect, THEME_VALUE(QString::fromStdString(rf.bgstyle)));
-        }
-
-        painter->drawText(chunkrect, Qt::TextSingleLine, chunk);
-        x += chunkrect.width();
+        if((x + run.x) > cliprect.right()) // Everything else is out on the right
+            break;
+
+        if(run.bgstyle != -1)
+            painter->fillRect(QRectF(x + run.x, y, run.width, fm.height()), THEME_STYLE(run.bgstyle).brush);
+
+        painter->setPen(THEME_STYLE(run.fgstyle).pen);
+        painter->drawStaticText(QPointF(x + run.x, y), run.text);
     }
 }
@@ -3,15 +3,22 @@
 
 #include <QFontMetricsF>
 #include <QTextCursor>
+#include <QPainter>
+#include <QCache>
 #include <QHash>
 #include <QFont>
 #include <redasm/disassembler/listing/listingdocument.h>
 #include <redasm/disassembler/listing/listingrenderer.h>
+#include "listingtextcache.h"
 
 #define CURSOR_BLINK_INTERVAL 500  // 500ms
+#define LINE_INDEX_CACHE_SIZE 1024 // Lines
 
 class ListingRendererCommon: public REDasm::ListingRenderer
 {
+    private:
+        struct LineIndex { std::string text; };
+
     public:
         ListingRendererCommon(REDasm::DisassemblerAPI* disassembler);
         virtual ~ListingRendererCommon() = default;
@@ -21,18 +28,27 @@ class ListingRendererCommon: public REDasm::ListingRenderer
         REDasm::ListingRenderer::Range wordHitTest(const QPointF& pos);
         std::string getWordFromPos(const QPointF& pos, Range *wordpos = nullptr);
         void selectWordAt(const QPointF &pos);
+        void invalidateIndex(size_t line);
+        void invalidateIndex();
         void setFirstVisibleLine(size_t line);
         const QFontMetricsF fontMetrics() const;
         qreal maxWidth() const;
 
     protected:
+        void validateIndex(const REDasm::RendererLine& rl);
         void insertText(const REDasm::RendererLine& rl, QTextCursor* textcursor);
-        void renderText(const REDasm::RendererLine& rl, float x, float y, const QFontMetricsF &fm);
+        void renderText(QPainter* painter, const ListingTextCache::Line* cl, qreal x, qreal y, const QFontMetricsF &fm);
+
+    private:
+        const LineIndex* lineIndex(size_t line);
 
     protected:
         QFontMetricsF m_fontmetrics;
-        qreal m_maxwidth;
+        QCache<size_t, LineIndex> m_lineindex;
+        qreal m_maxwidth, m_advance;
+        bool m_fixedpitch;
         size_t m_firstline;
+        int m_seekstyle;
 };
 
 #endif // LISTINGRENDERERCOMMON_H
@@ -0,0 +1,71 @@
+#include "listingtextcache.h"
+#include "../themeprovider.h"
+
+ListingTextCache::ListingTextCache(const QFont &font): m_lines(LISTING_TEXT_CACHE_SIZE), m_fontmetrics(font), m_font(font) { }
+const QFontMetricsF &ListingTextCache::fontMetrics() const { return m_fontmetrics; }
+
+const ListingTextCache::Line *ListingTextCache::line(const REDasm::RendererLine &rl)
+{
+    Line* cl = m_lines.object(rl.documentindex);
+
+    if(cl && this->isValid(cl, rl))
+        return cl;
+
+    cl = this->shape(rl);
+    m_lines.insert(rl.documentindex, cl); // Takes ownership
+    return cl;
+}
+
+void ListingTextCache::invalidate(size_t line) { m_lines.remove(line); }
+void ListingTextCache::clear() { m_lines.clear(); }
+
+bool ListingTextCache::isValid(const ListingTextCache::Line *cl, const REDasm::RendererLine &rl) const // Shifted lines are caught here, runs only depend on text and formats
+{
+    if((cl->highlighted != rl.highlighted) || (cl->formats.size() != rl.formats.size()) || (cl->text != rl.text))
+        return false;
+
+    auto it = cl->formats.begin();
+
+    for(const REDasm::RendererFormat& rf : rl.formats) // Cursor and selection only change formats
+    {
+        if((it->start != static_cast<s64>(rf.start)) || (it->end != static_cast<s64>(rf.end)) || (it->fgstyle != rf.fgstyle) || (it->bgstyle != rf.bgstyle))
+            return false;
+
+        it++;
+    }
+
+    return true;
+}
+
+ListingTextCache::Line *ListingTextCache::shape(const REDasm::RendererLine &rl) const
+{
+    Line* cl = new Line();
+    cl->highlighted = rl.highlighted;
+    cl->text = rl.text;
+    cl->width = 0;
+    cl->formats.reserve(rl.formats.size());
+    cl->runs.reserve(static_cast<int>(rl.formats.size()));
+
+    for(const REDasm::RendererFormat& rf : rl.formats)
+    {
+        cl->formats.push_back({ static_cast<s64>(rf.start), static_cast<s64>(rf.end), rf.fgstyle, rf.bgstyle });
+
+        QString chunk = QString::fromStdString(rl.formatText(rf));
+        Run run;
+
+        run.fgstyle = THEME_STYLE_ID(rf.fgstyle.empty() ? std::string("default_fg") : rf.fgstyle);
+        run.bgstyle = rf.bgstyle.empty() ? -1 : THEME_STYLE_ID(rf.bgstyle);
+
+        run.text.setTextFormat(Qt::PlainText);
+        run.text.setPerformanceHint(QStaticText::AggressiveCaching);
+        run.text.setText(chunk);
+        run.text.prepare(QTransform(), m_font);
+        run.x = cl->width;
+        run.width = m_fontmetrics.width(chunk);
+
+        cl->width += run.width;
+        cl->runs.push_back(run);
+    }
+
+    return cl;
+}
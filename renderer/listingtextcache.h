@@ -0,0 +1,44 @@
+#ifndef LISTINGTEXTCACHE_H
+#define LISTINGTEXTCACHE_H
+
+#include <QFontMetricsF>
+#include <QStaticText>
+#include <QVector>
+#include <QCache>
+#include <QFont>
+#include <redasm/disassembler/listing/listingrenderer.h>
+
+#define LISTING_TEXT_CACHE_SIZE 4096 // Lines
+
+class ListingTextCache
+{
+    public:
+        struct Format { s64 start, end; std::string fgstyle, bgstyle; };
+        struct Run { QStaticText text; int fgstyle, bgstyle; qreal x, width; }; // Style ids from ThemeProvider, bgstyle is -1 when unset
+
+        struct Line {
+            bool highlighted;
+            std::string text;
+            std::vector<Format> formats;
+            QVector<Run> runs;
+            qreal width;
+        };
+
+    public:
+        ListingTextCache(const QFont& font);
+        const Line* line(const REDasm::RendererLine& rl);
+        const QFontMetricsF& fontMetrics() const;
+        void invalidate(size_t line);
+        void clear();
+
+    private:
+        bool isValid(const Line* cl, const REDasm::RendererLine& rl) const;
+        Line* shape(const REDasm::RendererLine& rl) const;
+
+    private:
+        QCache<size_t, Line> m_lines;
+        QFontMetricsF m_fontmetrics;
+        QFont m_font;
+};
+
+#endif // LISTINGTEXTCACHE_H
@@ -1,21 +1,21 @@
 #include "listingtextrenderer.h"
-#include "../themeprovider.h"
+#include "../redasmsettings.h"
 #include <cmath>
-#include <QApplication>
-#include <QTextCharFormat>
-#include <QTextDocument>
-#include <QPalette>
 #include <QPainter>
 
-ListingTextRenderer::ListingTextRenderer(REDasm::DisassemblerAPI *disassembler): ListingRendererCommon(disassembler) { }
+ListingTextRenderer::ListingTextRenderer(REDasm::DisassemblerAPI *disassembler): ListingRendererCommon(disassembler), m_textcache(REDasmSettings::font()) { }
+ListingTextCache *ListingTextRenderer::textCache() { return &m_textcache; }
 
 void ListingTextRenderer::renderLine(const REDasm::RendererLine &rl)
 {
+    const ListingTextCache::Line* cl = m_textcache.line(rl);
+    this->validateIndex(rl);
+
     if(rl.index > 0)
-        m_maxwidth = std::max(m_maxwidth, m_fontmetrics.boundingRect(QString::fromStdString(rl.text)).width());
+        m_maxwidth = std::max(m_maxwidth, cl->width);
     else
-        m_maxwidth = m_fontmetrics.boundingRect(QString::fromStdString(rl.text)).width();
+        m_maxwidth = cl->width;
 
-    int y = (rl.documentindex - m_firstline) * m_fontmetrics.height();
-    ListingRendererCommon::renderText(rl, 0, y, m_fontmetrics);
+    qreal y = (rl.documentindex - m_firstline) * m_fontmetrics.height();
+    ListingRendererCommon::renderText(reinterpret_cast<QPainter*>(rl.userdata), cl, 0, y, m_fontmetrics);
 }
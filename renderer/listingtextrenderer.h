@@ -7,15 +7,20 @@
 #include <QFont>
 #include <redasm/disassembler/listing/listingrenderer.h>
 #include "listingrenderercommon.h"
+#include "listingtextcache.h"
 
 class ListingTextRenderer: public ListingRendererCommon
 {
     public:
         ListingTextRenderer(REDasm::DisassemblerAPI* disassembler);
         virtual ~ListingTextRenderer() = default;
+        ListingTextCache* textCache();
 
     protected:
         void renderLine(const REDasm::RendererLine& rl) override;
+
+    private:
+        ListingTextCache m_textcache;
 };
 
 #endif // LISTINGTEXTRENDERER_H
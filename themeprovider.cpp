@@ -10,6 +10,8 @@
 #define THEME_UI_SET_COLOR(palette, key) if(m_theme.contains(#key)) palette.setColor(QPalette::key, m_theme[#key].toString())
 
 QJsonObject ThemeProvider::m_theme;
+QVector<ThemeStyle> ThemeProvider::m_styles(1); // THEME_INVALID_STYLE
+std::unordered_map<std::string, int> ThemeProvider::m_styleids;
 
 QStringList ThemeProvider::themes() { return ThemeProvider::readThemes(":/themes");  }
 QString ThemeProvider::theme(const QString &name) { return QString(":/themes/%1.json").arg(name.toLower()); }
@@ -50,14 +52,27 @@ QColor ThemeProvider::themeValue(const QString &name)
 
         if(!ThemeProvider::loadTheme(settings.currentTheme()))
             return QColor();
+
+        ThemeProvider::compileStyles();
     }
 
-    if(m_theme.contains(name))
-        return QColor(m_theme[name].toString());
+    return ThemeProvider::style(ThemeProvider::styleId(name)).color;
+}
+
+int ThemeProvider::styleId(const QString &name) { return ThemeProvider::styleId(name.toStdString()); }
+
+int ThemeProvider::styleId(const std::string &name)
+{
+    auto it = m_styleids.find(name);
+
+    if(it != m_styleids.end())
+        return it->second;
 
-    return QColor();
+    return THEME_INVALID_STYLE;
 }
 
+const ThemeStyle &ThemeProvider::style(int id) { return m_styles.at(id); }
+
 QIcon ThemeProvider::icon(const QString &name)
 {
     REDasmSettings settings;
@@ -91,6 +106,50 @@ void ThemeProvider::applyTheme()
     THEME_UI_SET_COLOR(palette, ToolTipText);
 
     qApp->setPalette(palette);
+    ThemeProvider::compileStyles();
+}
+
+void ThemeProvider::compileStyles()
+{
+    for(auto it = m_theme.begin(); it != m_theme.end(); it++)
+    {
+        if(!it.value().isString())
+            continue;
+
+        QColor color(it.value().toString());
+
+        if(color.isValid())
+            ThemeProvider::compileStyle(it.key(), color);
+    }
+
+    // Listing styles that follow the application palette
+    QPalette palette = qApp->palette();
+    ThemeProvider::compileStyle("default_fg", palette.color(QPalette::WindowText));
+    ThemeProvider::compileStyle("cursor_fg", palette.color(QPalette::HighlightedText));
+    ThemeProvider::compileStyle("cursor_bg", palette.color(QPalette::WindowText));
+    ThemeProvider::compileStyle("selection_fg", palette.color(QPalette::HighlightedText));
+    ThemeProvider::compileStyle("selection_bg", palette.color(QPalette::Highlight));
+}
+
+void ThemeProvider::compileStyle(const QString &name, const QColor &color)
+{
+    ThemeStyle& style = m_styles[ThemeProvider::internStyle(name.toStdString())];
+    style.color = color;
+    style.pen = QPen(color);
+    style.brush = QBrush(color);
+}
+
+int ThemeProvider::internStyle(const std::string &name)
+{
+    auto it = m_styleids.find(name);
+
+    if(it != m_styleids.end())
+        return it->second;
+
+    int id = m_styles.size();
+    m_styles.push_back(ThemeStyle());
+    m_styleids[name] = id;
+    return id;
 }
 
 QStringList ThemeProvider::readThemes(const QString &path)
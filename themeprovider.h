@@ -4,10 +4,19 @@
 #define THEME_ICON(n)  ThemeProvider::icon(n)
 #define THEME_VALUE(n) ThemeProvider::themeValue(n)
 #define THEME_VALUE_COLOR(n) THEME_VALUE(n).name()
+#define THEME_STYLE_ID(n) ThemeProvider::styleId(n)
+#define THEME_STYLE(id) ThemeProvider::style(id)
+#define THEME_INVALID_STYLE 0 // Unknown style names, resolves to an invalid color
 
+#include <unordered_map>
 #include <QJsonObject>
+#include <QVector>
+#include <QBrush>
 #include <QColor>
 #include <QIcon>
+#include <QPen>
+
+struct ThemeStyle { QColor color; QPen pen; QBrush brush; };
 
 class ThemeProvider
 {
@@ -23,6 +32,9 @@ class ThemeProvider
         static bool contains(const QString& name);
         static bool isDarkTheme();
         static QColor themeValue(const QString& name);
+        static int styleId(const QString& name);
+        static int styleId(const std::string& name);
+        static const ThemeStyle& style(int id);
         static QIcon icon(const QString& name);
         static QColor seekColor();
         static QColor dottedColor();
@@ -31,9 +43,14 @@ class ThemeProvider
     private:
         static bool loadTheme(const QString &theme);
         static QStringList readThemes(const QString& path);
+        static void compileStyles();
+        static void compileStyle(const QString& name, const QColor& color);
+        static int internStyle(const std::string& name);
 
     private:
         static QJsonObject m_theme;
+        static QVector<ThemeStyle> m_styles; // Only written while the theme loads, read from any thread afterwards
+        static std::unordered_map<std::string, int> m_styleids;
 };
 
 #endif // THEMEPROVIDER_H
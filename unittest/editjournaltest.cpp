@@ -0,0 +1,155 @@
+#include "editjournaltest.h"
+#include <redasm/disassembler/listing/listingdocument.h>
+#include <iostream>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QFile>
+
+#define REPEAT_COUNT        20
+#define REPEATED(s)         std::string(REPEAT_COUNT, s)
+
+#define RED_STRING(s)       ("\x1b[31m" + std::string(s) + "\x1b[0m")
+#define GREEN_STRING(s)     ("\x1b[32m" + std::string(s) + "\x1b[0m")
+#define TEST_OK             GREEN_STRING("OK")
+#define TEST_FAIL           RED_STRING("FAIL")
+
+#define TEST(s, cond)       cout << "->> " << s << "..." << ((cond) ? TEST_OK : TEST_FAIL) << endl
+#define TITLE(t)            cout << REPEATED('-') << t << " " << REPEATED('-') << endl
+#define TEST_TITLE(t)       TITLE("Testing " << t)
+
+#define TEST_JOURNAL(name)  EditJournal::journalFile(m_tempdir.filePath(name))
+
+using namespace std;
+
+void EditJournalTest::runTests()
+{
+    TEST_TITLE("EditJournal");
+
+    if(!m_tempdir.isValid())
+    {
+        cout << "!!! SKIPPING TEST 'EditJournal', cannot create a temporary directory..." << endl << endl;
+        return;
+    }
+
+    this->testRoundTrip();
+    this->testAppend();
+    this->testTornTail();
+    this->testBadHeader();
+    this->testCompactEmpty();
+    cout << endl;
+}
+
+bool EditJournalTest::sameEdits(const QList<EditJournal::Edit> &edits1, const QList<EditJournal::Edit> &edits2)
+{
+    if(edits1.size() != edits2.size())
+        return false;
+
+    for(int i = 0; i < edits1.size(); i++)
+    {
+        const EditJournal::Edit& e1 = edits1[i];
+        const EditJournal::Edit& e2 = edits2[i];
+
+        if((e1.type != e2.type) || (e1.itemtype != e2.itemtype) || (e1.address != e2.address) || (e1.text != e2.text))
+            return false;
+    }
+
+    return true;
+}
+
+EditJournal::Edit EditJournalTest::edit(quint8 type, quint32 itemtype, address_t address, const QString &text)
+{
+    EditJournal::Edit e;
+    e.type = type;
+    e.itemtype = itemtype;
+    e.address = address;
+    e.text = text;
+    return e;
+}
+
+void EditJournalTest::testRoundTrip()
+{
+    EditJournal::Journal journal;
+    journal.filepath = TEST_JOURNAL("roundtrip.rdb");
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::FunctionItem, 0x401000, "main"));
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Comment, REDasm::ListingItem::InstructionItem, 0xFFFFFFFF00001234, QString::fromUtf8("Caf\xc3\xa9 \xe2\x86\x92 loop")));
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Comment, REDasm::ListingItem::SegmentItem, 0, QString()));
+
+    TEST("Writing journal", EditJournal::write(journal, 0, true));
+
+    EditJournal::Journal loaded;
+    loaded.filepath = journal.filepath;
+    TEST("Reading journal", EditJournal::read(&loaded));
+    TEST("Edits match", EditJournalTest::sameEdits(journal.edits, loaded.edits));
+}
+
+void EditJournalTest::testAppend()
+{
+    EditJournal::Journal journal;
+    journal.filepath = TEST_JOURNAL("append.rdb");
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::SymbolItem, 0x1000, "first"));
+    EditJournal::write(journal, 0, true);
+
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::SymbolItem, 0x2000, "second"));
+    TEST("Appending edit", EditJournal::write(journal, journal.edits.size() - 1, false));
+
+    EditJournal::Journal loaded;
+    loaded.filepath = journal.filepath;
+    TEST("Header written once", EditJournal::read(&loaded) && EditJournalTest::sameEdits(journal.edits, loaded.edits));
+}
+
+void EditJournalTest::testTornTail()
+{
+    EditJournal::Journal journal;
+    journal.filepath = TEST_JOURNAL("torntail.rdb");
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::FunctionItem, 0x1000, "complete"));
+    EditJournal::write(journal, 0, true);
+
+    QFile f(journal.filepath);
+    qint64 completesize = f.size();
+
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Comment, REDasm::ListingItem::InstructionItem, 0x1004, "torn comment"));
+    EditJournal::write(journal, 1, false);
+    TEST("Tearing last edit", f.resize(f.size() - 3)); // Cut inside the last string
+
+    EditJournal::Journal loaded;
+    loaded.filepath = journal.filepath;
+    TEST("Reading torn journal", EditJournal::read(&loaded));
+    TEST("Complete edits kept", EditJournalTest::sameEdits(journal.edits.mid(0, 1), loaded.edits));
+    TEST("Torn tail truncated", QFileInfo(journal.filepath).size() == completesize);
+
+    loaded.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::FunctionItem, 0x2000, "recovered"));
+    TEST("Appending after recovery", EditJournal::write(loaded, loaded.edits.size() - 1, false));
+
+    EditJournal::Journal reloaded;
+    reloaded.filepath = journal.filepath;
+    TEST("Edits after recovery kept", EditJournal::read(&reloaded) && EditJournalTest::sameEdits(loaded.edits, reloaded.edits));
+}
+
+void EditJournalTest::testBadHeader()
+{
+    EditJournal::Journal journal;
+    journal.filepath = TEST_JOURNAL("badheader.rdb");
+
+    QFile f(journal.filepath);
+    f.open(QFile::WriteOnly | QFile::Truncate);
+    QDataStream ds(&f);
+    ds << static_cast<quint32>(0xDEADBEEF) << static_cast<quint32>(1);
+    f.close();
+
+    TEST("Rejecting foreign file", !EditJournal::read(&journal) && journal.edits.empty());
+}
+
+void EditJournalTest::testCompactEmpty()
+{
+    EditJournal::Journal journal;
+    journal.filepath = TEST_JOURNAL("compact.rdb");
+    journal.edits.push_back(EditJournalTest::edit(EditJournal::Rename, REDasm::ListingItem::FunctionItem, 0x1000, "saved"));
+    EditJournal::write(journal, 0, true);
+
+    journal.edits.clear();
+    TEST("Compacting to nothing", EditJournal::write(journal, 0, true) && !QFile::exists(journal.filepath));
+
+    EditJournal::Journal loaded;
+    loaded.filepath = journal.filepath;
+    TEST("Missing journal is empty", EditJournal::read(&loaded) && loaded.edits.empty());
+}
@@ -0,0 +1,28 @@
+#ifndef EDITJOURNALTEST_H
+#define EDITJOURNALTEST_H
+
+#include <QTemporaryDir>
+#include "../editjournal.h"
+
+class EditJournalTest
+{
+    public:
+        EditJournalTest() = default;
+        void runTests();
+
+    private:
+        static bool sameEdits(const QList<EditJournal::Edit>& edits1, const QList<EditJournal::Edit>& edits2);
+        static EditJournal::Edit edit(quint8 type, quint32 itemtype, address_t address, const QString& text);
+
+    private: // Tests
+        void testRoundTrip();
+        void testAppend();
+        void testTornTail();
+        void testBadHeader();
+        void testCompactEmpty();
+
+    private:
+        QTemporaryDir m_tempdir;
+};
+
+#endif // EDITJOURNALTEST_H
@@ -1,10 +1,14 @@
 #include "unittest.h"
 #include "disassemblertest.h"
+#include "editjournaltest.h"
 #include <redasm/redasm_context.h>
 
 int UnitTest::run()
 {
     REDasm::Context::sync(true);
+    EditJournalTest journaltest;
+    journaltest.runTests();
+
     DisassemblerTest disasmtest;
     disasmtest.runTests();
     return 0;
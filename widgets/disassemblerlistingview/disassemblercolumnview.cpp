@@ -1,78 +1,45 @@
 #include "disassemblercolumnview.h"
 #include "../../themeprovider.h"
 #include <QPainter>
+#include <algorithm>
 
-DisassemblerColumnView::DisassemblerColumnView(QWidget *parent) : QWidget(parent), m_disassembler(nullptr), m_first(-1), m_last(-1)
+DisassemblerColumnView::DisassemblerColumnView(QWidget *parent) : QWidget(parent), m_disassembler(nullptr), m_first(-1), m_last(-1), m_indexdirty(true)
 {
     this->setBackgroundRole(QPalette::Base);
     this->setAutoFillBackground(true);
 }
 
-void DisassemblerColumnView::setDisassembler(const REDasm::DisassemblerPtr& disassembler) { m_disassembler = disassembler; }
+void DisassemblerColumnView::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
+{
+    m_disassembler = disassembler;
+    m_indexdirty = true;
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, std::bind(&DisassemblerColumnView::onDocumentChanged, this, std::placeholders::_1));
+}
 
 void DisassemblerColumnView::renderArrows(size_t start, size_t count)
 {
+    if(m_indexdirty)
+        this->buildIndex();
+    else if((m_first == start) && (m_last == (start + count - 1)))
+        return; // Same range, paths and lanes are still valid
+
     m_first = start;
     m_last = start + count - 1;
-
     m_paths.clear();
-    m_done.clear();
-
-    auto& document = m_disassembler->document();
-
-    for(size_t i = 0; i < count; i++, start++)
-    {
-        if(start >= document->size())
-            break;
-
-        REDasm::ListingItem* item = document->itemAt(start);
-
-        if(item->is(REDasm::ListingItem::InstructionItem))
-        {
-            REDasm::InstructionPtr instruction = document->instruction(item->address);
-
-            if(!instruction->is(REDasm::InstructionType::Jump))
-                continue;
 
-            for(address_t target : m_disassembler->getTargets(instruction->address))
-            {
-                if(target == instruction->address)
-                    continue;
+    auto byStart = [](const ArrowPath& path, u64 idx) -> bool { return path.startidx < idx; };
+    auto byEnd = [](const ArrowPath& path, u64 idx) -> bool { return path.endidx < idx; };
 
-                size_t idx = document->instructionIndex(target);
+    for(auto it = std::lower_bound(m_pathsbystart.begin(), m_pathsbystart.end(), m_first, byStart); (it != m_pathsbystart.end()) && (it->startidx <= m_last); it++)
+        m_paths.push_back(*it);
 
-                if(idx >= document->size())
-                    continue;
-
-                this->insertPath(item, start, idx);
-            }
-        }
-        else if(item->is(REDasm::ListingItem::SymbolItem))
-        {
-            const REDasm::Symbol* symbol = document->symbol(item->address);
-
-            if(!symbol || !symbol->is(REDasm::SymbolType::Code))
-                continue;
-
-            REDasm::ReferenceVector refs = m_disassembler->getReferences(item->address);
-            size_t toidx = document->instructionIndex(item->address);
-
-            if(toidx >= document->size())
-                continue;
-
-            for(address_t ref : refs)
-            {
-                if(ref == item->address)
-                    continue;
-
-                size_t idx = document->instructionIndex(ref);
-
-                if(idx >= document->size())
-                    continue;
+    for(auto it = std::lower_bound(m_pathsbyend.begin(), m_pathsbyend.end(), m_first, byEnd); (it != m_pathsbyend.end()) && (it->endidx <= m_last); it++)
+    {
+        if((it->startidx >= m_first) && (it->startidx <= m_last)) // Already collected by its start
+            continue;
 
-                this->insertPath(document->itemAt(idx), idx, toidx);
-            }
-        }
+        m_paths.push_back(*it);
     }
 
     std::sort(m_paths.begin(), m_paths.end(), [](const ArrowPath& p1, const ArrowPath& p2) -> bool {
@@ -140,29 +107,181 @@ void DisassemblerColumnView::fillArrow(QPainter* painter, int y, const QFontMetr
     painter->fillPath(path, painter->pen().brush());
 }
 
-void DisassemblerColumnView::insertPath(REDasm::ListingItem* fromitem, u64 fromidx, u64 toidx)
+void DisassemblerColumnView::onDocumentChanged(const REDasm::ListingDocumentChanged *ldc)
+{
+    if(m_disassembler->busy() || m_indexdirty) // Rebuilt in one pass once analysis is done
+    {
+        m_indexdirty = true;
+        return;
+    }
+
+    if(ldc->action == REDasm::ListingDocumentChanged::Changed)
+        return;
+
+    this->shiftIndex(ldc->index, ldc->isInserted());
+
+    if(!ldc->isInserted())
+        return;
+
+    QVector<ArrowPath> paths;
+    PathSet done;
+
+    this->collectPaths(ldc->index, &done, &paths);
+    this->insertIndex(paths);
+    m_first = m_last = -1; // Force a new query
+}
+
+void DisassemblerColumnView::collectPaths(size_t idx, PathSet* done, QVector<ArrowPath>* paths)
+{
+    auto& document = m_disassembler->document();
+
+    if(idx >= document->size())
+        return;
+
+    REDasm::ListingItem* item = document->itemAt(idx);
+
+    if(item->is(REDasm::ListingItem::InstructionItem))
+    {
+        REDasm::InstructionPtr instruction = document->instruction(item->address);
+
+        if(!instruction->is(REDasm::InstructionType::Jump))
+            return;
+
+        for(address_t target : m_disassembler->getTargets(instruction->address))
+        {
+            if(target == instruction->address)
+                continue;
+
+            size_t toidx = document->instructionIndex(target);
+
+            if(toidx >= document->size())
+                continue;
+
+            this->insertPath(item, idx, toidx, done, paths);
+        }
+    }
+    else if(item->is(REDasm::ListingItem::SymbolItem))
+    {
+        const REDasm::Symbol* symbol = document->symbol(item->address);
+
+        if(!symbol || !symbol->is(REDasm::SymbolType::Code))
+            return;
+
+        REDasm::ReferenceVector refs = m_disassembler->getReferences(item->address);
+        size_t toidx = document->instructionIndex(item->address);
+
+        if(toidx >= document->size())
+            return;
+
+        for(address_t ref : refs)
+        {
+            if(ref == item->address)
+                continue;
+
+            size_t fromidx = document->instructionIndex(ref);
+
+            if(fromidx >= document->size())
+                continue;
+
+            this->insertPath(document->itemAt(fromidx), fromidx, toidx, done, paths);
+        }
+    }
+}
+
+void DisassemblerColumnView::insertPath(REDasm::ListingItem* fromitem, u64 fromidx, u64 toidx, PathSet* done, QVector<ArrowPath>* paths)
 {
     auto& document = m_disassembler->document();
     auto pair = qMakePair(fromidx, toidx);
     REDasm::InstructionPtr frominstruction = document->instruction(fromitem->address);
 
-    if(!frominstruction || !frominstruction->is(REDasm::InstructionType::Jump) || m_done.contains(pair))
+    if(!frominstruction || !frominstruction->is(REDasm::InstructionType::Jump) || done->contains(pair) || this->containsPath(fromidx, toidx))
         return;
 
-    m_done.insert(pair);
+    done->insert(pair);
 
     if(fromidx > toidx) // Loop
     {
         if(frominstruction->is(REDasm::InstructionType::Conditional))
-            m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_loop_c") });
+            paths->append({ fromidx, toidx, THEME_VALUE("graph_edge_loop_c") });
         else
-            m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_loop") });
+            paths->append({ fromidx, toidx, THEME_VALUE("graph_edge_loop") });
 
         return;
     }
 
     if(frominstruction->is(REDasm::InstructionType::Conditional))
-        m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge_false") });
+        paths->append({ fromidx, toidx, THEME_VALUE("graph_edge_false") });
     else
-        m_paths.append({ fromidx, toidx, THEME_VALUE("graph_edge") });
+        paths->append({ fromidx, toidx, THEME_VALUE("graph_edge") });
+}
+
+bool DisassemblerColumnView::containsPath(u64 fromidx, u64 toidx) const
+{
+    auto it = std::lower_bound(m_pathsbystart.begin(), m_pathsbystart.end(), fromidx, [](const ArrowPath& path, u64 idx) -> bool {
+        return path.startidx < idx;
+    });
+
+    for( ; (it != m_pathsbystart.end()) && (it->startidx == fromidx); it++)
+    {
+        if(it->endidx == toidx)
+            return true;
+    }
+
+    return false;
+}
+
+void DisassemblerColumnView::insertIndex(const QVector<ArrowPath> &paths)
+{
+    m_pathsbystart += paths;
+    m_pathsbyend += paths;
+
+    std::stable_sort(m_pathsbystart.begin(), m_pathsbystart.end(), [](const ArrowPath& p1, const ArrowPath& p2) -> bool {
+        return p1.startidx < p2.startidx;
+    });
+
+    std::stable_sort(m_pathsbyend.begin(), m_pathsbyend.end(), [](const ArrowPath& p1, const ArrowPath& p2) -> bool {
+        return p1.endidx < p2.endidx;
+    });
+}
+
+void DisassemblerColumnView::shiftIndex(u64 idx, bool inserted)
+{
+    auto shift = [=](QVector<ArrowPath>& paths) {
+        QVector<ArrowPath> shifted;
+        shifted.reserve(paths.size());
+
+        for(ArrowPath path : paths) // Shifting keeps the sort order
+        {
+            if(!inserted && ((path.startidx == idx) || (path.endidx == idx)))
+                continue;
+
+            if(path.startidx >= idx)
+                path.startidx = inserted ? path.startidx + 1 : path.startidx - 1;
+            if(path.endidx >= idx)
+                path.endidx = inserted ? path.endidx + 1 : path.endidx - 1;
+
+            shifted.push_back(path);
+        }
+
+        paths.swap(shifted);
+    };
+
+    shift(m_pathsbystart);
+    shift(m_pathsbyend);
+}
+
+void DisassemblerColumnView::buildIndex()
+{
+    auto& document = m_disassembler->document();
+    QVector<ArrowPath> paths;
+    PathSet done;
+
+    m_pathsbystart.clear();
+    m_pathsbyend.clear();
+
+    for(size_t i = 0; i < document->size(); i++)
+        this->collectPaths(i, &done, &paths);
+
+    this->insertIndex(paths);
+    m_indexdirty = false;
 }
@@ -2,6 +2,7 @@
 #define DISASSEMBLERCOLUMNVIEW_H
 
 #include <QWidget>
+#include <QVector>
 #include <QList>
 #include <QPair>
 #include <QSet>
@@ -14,6 +15,7 @@ class DisassemblerColumnView : public QWidget
 
     private:
         struct ArrowPath{ u64 startidx, endidx; QColor color; };
+        typedef QSet< QPair<u64, u64> > PathSet;
 
     public:
         explicit DisassemblerColumnView(QWidget *parent = nullptr);
@@ -25,14 +27,21 @@ class DisassemblerColumnView : public QWidget
 
     private:
         bool isPathSelected(const ArrowPath& path) const;
+        bool containsPath(u64 fromidx, u64 toidx) const;
         void fillArrow(QPainter* painter, int y, const QFontMetrics &fm);
-        void insertPath(REDasm::ListingItem *fromitem, u64 fromidx, u64 toidx);
+        void onDocumentChanged(const REDasm::ListingDocumentChanged* ldc);
+        void collectPaths(size_t idx, PathSet* done, QVector<ArrowPath>* paths);
+        void insertPath(REDasm::ListingItem *fromitem, u64 fromidx, u64 toidx, PathSet* done, QVector<ArrowPath>* paths);
+        void insertIndex(const QVector<ArrowPath>& paths);
+        void shiftIndex(u64 idx, bool inserted);
+        void buildIndex();
 
     private:
         REDasm::DisassemblerPtr m_disassembler;
+        QVector<ArrowPath> m_pathsbystart, m_pathsbyend; // Jump edges over document lines, sorted by each endpoint
         QList<ArrowPath> m_paths;
-        QSet< QPair<u64, u64> > m_done;
         u64 m_first, m_last;
+        bool m_indexdirty;
 };
 
 #endif // DISASSEMBLERCOLUMNVIEW_H
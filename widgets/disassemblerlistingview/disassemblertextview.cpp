@@ -9,13 +9,11 @@
 #define DOCUMENT_IDEAL_SIZE   10
 #define DOCUMENT_WHEEL_LINES  3
 
-DisassemblerTextView::DisassemblerTextView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(nullptr), m_disassemblerpopup(nullptr), m_actions(nullptr), m_refreshtimerid(-1)
+DisassemblerTextView::DisassemblerTextView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(nullptr), m_disassemblerpopup(nullptr), m_actions(nullptr), m_refreshtimerid(-1), m_lastline(0), m_scrollwidth(0), m_hadselection(false)
 {
     QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
     font.setStyleHint(QFont::TypeWriter);
 
-    int maxwidth = qApp->primaryScreen()->size().width();
-    this->viewport()->setFixedWidth(maxwidth);
     this->setPalette(qApp->palette()); // Don't inherit palette
 
     this->setFont(font);
@@ -30,7 +28,7 @@ DisassemblerTextView::DisassemblerTextView(QWidget *parent): QAbstractScrollArea
     this->horizontalScrollBar()->setSingleStep(this->fontMetrics().boundingRect(" ").width());
     this->horizontalScrollBar()->setMinimum(0);
     this->horizontalScrollBar()->setValue(0);
-    this->horizontalScrollBar()->setMaximum(maxwidth);
+    this->horizontalScrollBar()->setMaximum(0);
 
     float refreshfreq = qApp->primaryScreen()->refreshRate();
 
@@ -86,11 +84,11 @@ void DisassemblerTextView::setDisassembler(const REDasm::DisassemblerPtr& disass
         QMetaObject::invokeMethod(this, "moveToSelection", Qt::QueuedConnection);
     });
 
+    this->horizontalScrollBar()->setMaximum(0);
     this->adjustScrollBars();
 
-    connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this, [&](int) { this->renderListing(); });
-
     m_renderer = std::make_unique<ListingTextRenderer>(m_disassembler.get());
+    m_scrollwidth = 0;
 
     if(m_actions)
     {
@@ -128,7 +126,8 @@ void DisassemblerTextView::renderListing(const QRect &r)
     else
         this->viewport()->update(r);
 
-    m_refreshtimerid = this->startTimer(m_refreshrate);
+    if(m_disassembler->busy()) // Keep refreshing while the listing grows
+        m_refreshtimerid = this->startTimer(m_refreshrate);
 }
 
 void DisassemblerTextView::blinkCursor()
@@ -154,14 +153,23 @@ void DisassemblerTextView::blinkCursor()
 
 void DisassemblerTextView::scrollContentsBy(int dx, int dy)
 {
-    if(dx)
+    if(!m_renderer)
+    {
+        QAbstractScrollArea::scrollContentsBy(dx, dy);
+        return;
+    }
+
+    qreal lineheight = m_renderer->fontMetrics().height();
+
+    // Blit what is already on screen and let Qt request the exposed strip only,
+    // fractional line heights cannot be moved pixel-exact: repaint everything
+    if((static_cast<size_t>(std::abs(dy)) >= this->visibleLines()) || !qFuzzyCompare(lineheight, std::round(lineheight)))
     {
-        QWidget* viewport = this->viewport();
-        viewport->move(viewport->x() + dx, viewport->y());
+        this->renderListing();
         return;
     }
 
-    QAbstractScrollArea::scrollContentsBy(dx, dy);
+    this->viewport()->scroll(dx, dy * static_cast<int>(std::round(lineheight)));
 }
 
 void DisassemblerTextView::paintEvent(QPaintEvent *e)
@@ -171,23 +179,33 @@ void DisassemblerTextView::paintEvent(QPaintEvent *e)
     if(!m_disassembler || !m_renderer)
         return;
 
-    QFontMetrics fm = this->fontMetrics();
+    qreal lineheight = m_renderer->fontMetrics().height();
     const QRect& r = e->rect();
+    int xofs = this->horizontalScrollBar()->value();
 
     size_t firstvisible = this->firstVisibleLine();
-    size_t first = firstvisible + (r.top() / fm.height());
-    size_t last = firstvisible + (r.bottom() / fm.height());
+    size_t first = firstvisible + static_cast<size_t>(std::floor(r.top() / lineheight));
+    size_t last = firstvisible + static_cast<size_t>(std::floor(r.bottom() / lineheight));
 
     QPainter painter(this->viewport());
     painter.setFont(this->font());
+    painter.translate(-xofs, 0);
+    painter.setClipRect(r.translated(xofs, 0)); // Only the visible horizontal region is drawn
     m_renderer->setFirstVisibleLine(firstvisible);
     this->paintLines(&painter, first, last);
+
+    if(m_renderer->maxWidth() > m_scrollwidth) // Changing the range while painting can relayout and repaint again
+    {
+        m_scrollwidth = m_renderer->maxWidth();
+        QMetaObject::invokeMethod(this, "updateHorizontalScrollBar", Qt::QueuedConnection);
+    }
 }
 
 void DisassemblerTextView::resizeEvent(QResizeEvent *e)
 {
     QAbstractScrollArea::resizeEvent(e);
     this->adjustScrollBars();
+    this->updateHorizontalScrollBar();
 }
 
 void DisassemblerTextView::mousePressEvent(QMouseEvent *e)
@@ -197,7 +215,7 @@ void DisassemblerTextView::mousePressEvent(QMouseEvent *e)
     if((e->button() == Qt::LeftButton) || (!cur->hasSelection() && (e->button() == Qt::RightButton)))
     {
         e->accept();
-        m_renderer->moveTo(e->pos());
+        m_renderer->moveTo(this->contentPos(e->pos()));
     }
     else if(e->button() == Qt::BackButton)
         this->currentDocument()->cursor()->goBack();
@@ -217,7 +235,7 @@ void DisassemblerTextView::mouseMoveEvent(QMouseEvent *e)
         QPoint pos = e->pos();
         pos.rx() = std::max(0, pos.x());
         pos.ry() = std::max(0, pos.y());
-        m_renderer->select(pos);
+        m_renderer->select(this->contentPos(pos));
     }
     else
         QAbstractScrollArea::mouseMoveEvent(e);
@@ -236,7 +254,7 @@ void DisassemblerTextView::mouseDoubleClickEvent(QMouseEvent *e)
     if(e->button() == Qt::LeftButton)
     {
         if(!m_actions->followUnderCursor())
-            m_renderer->selectWordAt(e->pos());
+            m_renderer->selectWordAt(this->contentPos(e->pos()));
 
         e->accept();
         return;
@@ -400,7 +418,7 @@ bool DisassemblerTextView::event(QEvent *e)
     if(m_disassembler && !m_disassembler->busy() && (e->type() == QEvent::ToolTip))
     {
         QHelpEvent* helpevent = static_cast<QHelpEvent*>(e);
-        this->showPopup(helpevent->pos());
+        this->showPopup(this->contentPos(helpevent->pos()));
         return true;
     }
 
@@ -423,10 +441,14 @@ void DisassemblerTextView::onDocumentChanged(const REDasm::ListingDocumentChange
         if(ldc->index > this->lastVisibleLine()) // Don't care of bottom Insertion/Deletion
             return;
 
+        QMetaObject::invokeMethod(this, "invalidateLines", Qt::QueuedConnection); // Cached lines are shifted
         //QMetaObject::invokeMethod(this, "renderListing", Qt::QueuedConnection);
     }
     else
+    {
+        QMetaObject::invokeMethod(this, "invalidateLine", Qt::QueuedConnection, Q_ARG(u64, ldc->index));
         QMetaObject::invokeMethod(this, "renderLine", Qt::QueuedConnection, Q_ARG(u64, ldc->index));
+    }
 }
 
 REDasm::ListingDocument &DisassemblerTextView::currentDocument() { return m_disassembler->document(); }
@@ -487,9 +509,9 @@ QRect DisassemblerTextView::lineRect(size_t line)
         return QRect();
 
     QRect vprect = this->viewport()->rect();
-    QFontMetrics fm = this->fontMetrics();
+    qreal lineheight = m_renderer->fontMetrics().height();
     u64 offset = line - this->firstVisibleLine();
-    return QRect(vprect.x(), offset * fm.height(), vprect.width(), fm.height());
+    return QRectF(vprect.x(), offset * lineheight, vprect.width(), lineheight).toAlignedRect();
 }
 
 void DisassemblerTextView::renderLine(size_t line)
@@ -500,6 +522,23 @@ void DisassemblerTextView::renderLine(size_t line)
     this->paintLines(line, line);
 }
 
+void DisassemblerTextView::invalidateLine(u64 line)
+{
+    if(!m_renderer)
+        return;
+
+    m_renderer->textCache()->invalidate(line);
+    m_renderer->invalidateIndex(line);
+}
+
+void DisassemblerTextView::invalidateLines()
+{
+    if(!m_renderer)
+        return;
+
+    m_renderer->invalidateIndex();
+}
+
 void DisassemblerTextView::paintLines(size_t first, size_t last)
 {
     first = std::max(first, this->firstVisibleLine());
@@ -511,6 +550,20 @@ void DisassemblerTextView::paintLines(size_t first, size_t last)
     this->renderListing(QRect(firstrect.topLeft(), lastrect.bottomRight()));
 }
 
+void DisassemblerTextView::updateHorizontalScrollBar()
+{
+    if(!m_renderer)
+        return;
+
+    QScrollBar* hscrollbar = this->horizontalScrollBar();
+    int maxwidth = static_cast<int>(std::ceil(m_scrollwidth)) - this->viewport()->width();
+
+    hscrollbar->setPageStep(this->viewport()->width());
+
+    if(maxwidth > hscrollbar->maximum()) // Only grow: shrinking would scroll again
+        hscrollbar->setMaximum(maxwidth);
+}
+
 void DisassemblerTextView::adjustScrollBars()
 {
     if(!m_disassembler)
@@ -531,14 +584,28 @@ void DisassemblerTextView::moveToSelection()
 {
     auto lock = REDasm::s_lock_safe_ptr(this->currentDocument());
     REDasm::ListingCursor* cur = lock->cursor();
+    std::string word = m_renderer ? m_renderer->getCurrentWord() : std::string();
+
+    // Word highlighting and selections can touch any visible line
+    bool repaintall = cur->hasSelection() || m_hadselection || (word != m_currentword);
 
     if(!this->isLineVisible(cur->currentLine())) // Center on selection
     {
         QScrollBar* vscrollbar = this->verticalScrollBar();
         vscrollbar->setValue(std::max(static_cast<s64>(0), static_cast<s64>(cur->currentLine() - this->visibleLines() / 2)));
     }
-    else
+
+    if(repaintall)
         this->renderListing();
+    else
+    {
+        this->renderLine(m_lastline);
+        this->renderLine(cur->currentLine());
+    }
+
+    m_lastline = cur->currentLine();
+    m_currentword = word;
+    m_hadselection = cur->hasSelection();
 
     this->ensureColumnVisible();
     REDasm::ListingItem* item = lock->itemAt(cur->currentLine());
@@ -563,6 +630,8 @@ void DisassemblerTextView::ensureColumnVisible()
     hscrollbar->setValue(xpos);
 }
 
+QPoint DisassemblerTextView::contentPos(const QPoint &pos) const { return QPoint(pos.x() + this->horizontalScrollBar()->value(), pos.y()); }
+
 void DisassemblerTextView::showPopup(const QPoint& pos)
 {
     std::string word = m_renderer->getWordFromPos(pos);
@@ -30,7 +30,10 @@ class DisassemblerTextView : public QAbstractScrollArea
     private slots:
         void renderListing(const QRect& r = QRect());
         void renderLine(size_t line);
+        void invalidateLine(u64 line);
+        void invalidateLines();
         void moveToSelection();
+        void updateHorizontalScrollBar();
 
     protected:
         void scrollContentsBy(int dx, int dy) override;
@@ -54,6 +57,7 @@ class DisassemblerTextView : public QAbstractScrollArea
         bool isLineVisible(size_t line) const;
         bool isColumnVisible(size_t column, size_t *xpos);
         QRect lineRect(size_t line);
+        QPoint contentPos(const QPoint& pos) const;
         void paintLines(size_t first, size_t last);
         void blinkCursor();
         void adjustScrollBars();
@@ -72,6 +76,10 @@ class DisassemblerTextView : public QAbstractScrollArea
         DisassemblerPopup* m_disassemblerpopup;
         DisassemblerActions* m_actions;
         int m_refreshrate, m_blinktimerid, m_refreshtimerid;
+        std::string m_currentword;
+        size_t m_lastline;
+        qreal m_scrollwidth;
+        bool m_hadselection;
 };
 
 #endif // DISASSEMBLERTEXTVIEW_H
@@ -3,13 +3,14 @@
 #include "../../dialogs/dev/iteminformationdialog/iteminformationdialog.h"
 #include "../../dialogs/referencesdialog/referencesdialog.h"
 #include "../../themeprovider.h"
+#include "../../demanglecache.h"
 #include "../../redasmsettings.h"
 #include <QHexView/document/buffer/qmemoryrefbuffer.h>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QDebug>
 
-DisassemblerView::DisassemblerView(QLineEdit *lefilter, QWidget *parent) : QWidget(parent), ui(new Ui::DisassemblerView), m_disassembler(nullptr), m_hexdocument(nullptr), m_lefilter(lefilter)
+DisassemblerView::DisassemblerView(QLineEdit *lefilter, QWidget *parent) : QWidget(parent), ui(new Ui::DisassemblerView), m_disassembler(nullptr), m_hexdocument(nullptr), m_lefilter(lefilter), m_prefetched(false)
 {
     ui->setupUi(this);
 
@@ -160,7 +161,11 @@ void DisassemblerView::bindDisassembler(REDasm::DisassemblerAPI *disassembler, b
     m_actions->setEnabled(DisassemblerViewActions::BackAction, m_disassembler->document()->cursor()->canGoBack());
     m_actions->setEnabled(DisassemblerViewActions::ForwardAction, m_disassembler->document()->cursor()->canGoForward());
 
-    if(!fromdatabase)
+    m_prefetched = fromdatabase; // Databases don't fire busyChanged
+
+    if(fromdatabase)
+        DemangleCache::prefetch(m_disassembler);
+    else
         m_disassembler->disassemble();
 }
 
@@ -185,6 +190,12 @@ void DisassemblerView::checkDisassemblerStatus()
 
     m_actions->setEnabled(DisassemblerViewActions::GotoAction, !m_disassembler->busy());
     m_actions->setEnabled(DisassemblerViewActions::GraphListingAction, !m_disassembler->busy());
+
+    if(m_prefetched || m_disassembler->busy() || (m_disassembler->state() == REDasm::Job::PausedState))
+        return;
+
+    m_prefetched = true;
+    DemangleCache::prefetch(m_disassembler);
 }
 
 void DisassemblerView::modelIndexSelected(const QModelIndex &index)
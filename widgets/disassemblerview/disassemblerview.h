@@ -76,6 +76,7 @@ class DisassemblerView : public QWidget
         QLineEdit* m_lefilter;
         ListingFilterModel *m_segmentsmodel, *m_importsmodel, *m_exportsmodel, *m_stringsmodel;
         QAction* m_actsetfilter;
+        bool m_prefetched; // Demangled names, once the analysis is done
 };
 
 #endif // DISASSEMBLERVIEW_H
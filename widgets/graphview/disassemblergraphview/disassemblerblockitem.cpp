@@ -8,30 +8,51 @@
 #define BLOCK_MARGIN 4
 #define DROP_SHADOW_SIZE  10
 #define BLOCK_MARGINS -BLOCK_MARGIN, 0, BLOCK_MARGIN, BLOCK_MARGIN
+#define SUMMARY_TITLE_SIZE 11 // Pixels on screen, regardless of zoom level
 
-DisassemblerBlockItem::DisassemblerBlockItem(const REDasm::Graphing::FunctionBasicBlock *fbb, const REDasm::DisassemblerPtr &disassembler, const REDasm::Graphing::Node &node, QWidget *parent) : GraphViewItem(node, parent), m_basicblock(fbb), m_disassembler(disassembler)
+DisassemblerBlockItem::DisassemblerBlockItem(const REDasm::Graphing::FunctionBasicBlock *fbb, const REDasm::DisassemblerPtr &disassembler, const REDasm::Graphing::Node &node, QWidget *parent) : GraphViewItem(node, parent), m_basicblock(fbb), m_disassembler(disassembler), m_lastline(REDasm::npos), m_hadselection(false)
 {
-    this->setupDocument();
+    m_renderer = std::make_unique<ListingBlockRenderer>(disassembler.get());
+    this->setBasicBlock(fbb, node);
+}
+
+DisassemblerBlockItem::~DisassemblerBlockItem() { this->release(); }
+
+void DisassemblerBlockItem::setBasicBlock(const REDasm::Graphing::FunctionBasicBlock *fbb, const REDasm::Graphing::Node &node)
+{
+    this->release();
+    this->setNode(node);
 
-    m_renderer = std::make_unique<ListingDocumentRenderer>(disassembler.get());
-    m_renderer->setFirstVisibleLine(fbb->startidx);
-    m_renderer->setFlags(ListingDocumentRenderer::HideSegmentName);
-    this->invalidate(false);
+    m_basicblock = fbb;
+    m_lastline = REDasm::npos;
+    m_hadselection = false;
+    m_currentword.clear();
+    m_title.clear();
+    m_renderer->setRange(fbb->startidx, fbb->count()); // Shaped text is shared through the renderer's cache
 
-    QFontMetricsF fm(m_document.defaultFont());
-    m_charheight = fm.height();
+    REDasm::ListingItem* item = m_disassembler->document()->itemAt(fbb->startidx);
+
+    if(item)
+        m_title = QString::fromStdString(REDasm::hex(item->address, m_disassembler->assembler()->bits()));
 
     EVENT_CONNECT(m_disassembler->document()->cursor(), positionChanged, this, [&]() {
-        if(!m_basicblock->contains(m_disassembler->document()->cursor()->currentLine()))
+        const REDasm::ListingCursor* cursor = m_disassembler->document()->cursor();
+
+        if(!m_basicblock->contains(cursor->currentLine()) && !m_basicblock->contains(m_lastline) && !cursor->hasSelection() && !m_hadselection)
             return;
 
         this->invalidate();
     });
 }
 
-DisassemblerBlockItem::~DisassemblerBlockItem() { EVENT_DISCONNECT(m_disassembler->document()->cursor(), positionChanged, this); }
+void DisassemblerBlockItem::release()
+{
+    EVENT_DISCONNECT(m_disassembler->document()->cursor(), positionChanged, this);
+    m_renderer->clear();
+}
+
 std::string DisassemblerBlockItem::currentWord() { return m_renderer->getCurrentWord(); }
-ListingDocumentRenderer *DisassemblerBlockItem::renderer() const { return m_renderer.get(); }
+ListingBlockRenderer *DisassemblerBlockItem::renderer() const { return m_renderer.get(); }
 bool DisassemblerBlockItem::containsIndex(s64 index) const { return m_basicblock->contains(index); }
 
 int DisassemblerBlockItem::currentLine() const
@@ -73,17 +94,28 @@ void DisassemblerBlockItem::mouseMoveEvent(QMouseEvent *e)
 
 void DisassemblerBlockItem::invalidate(bool notify)
 {
-    m_document.clear();
-    m_renderer->render(m_basicblock->startidx, m_basicblock->count(), &m_document);
-    m_document.adjustSize();
+    const REDasm::ListingCursor* cursor = m_disassembler->document()->cursor();
+    std::string word = m_renderer->getCurrentWord();
+
+    if(cursor->hasSelection() || m_hadselection || (word != m_currentword)) // Can touch any line of the block
+        m_renderer->update();
+    else
+    {
+        m_renderer->updateLine(m_lastline);
+        m_renderer->updateLine(cursor->currentLine());
+    }
+
+    m_lastline = cursor->currentLine();
+    m_currentword = word;
+    m_hadselection = cursor->hasSelection();
 
     GraphViewItem::invalidate(notify);
 }
 
 QSize DisassemblerBlockItem::documentSize() const
 {
-    return { static_cast<int>(m_document.size().width()),
-             static_cast<int>(std::ceil(m_charheight * m_basicblock->count())) };
+    QSizeF sz = m_renderer->size();
+    return { static_cast<int>(std::ceil(sz.width())), static_cast<int>(std::ceil(sz.height())) };
 }
 
 void DisassemblerBlockItem::render(QPainter *painter, size_t state)
@@ -103,7 +135,7 @@ void DisassemblerBlockItem::render(QPainter *painter, size_t state)
             painter->fillRect(r.adjusted(DROP_SHADOW_SIZE, DROP_SHADOW_SIZE, DROP_SHADOW_SIZE, DROP_SHADOW_SIZE), shadow);
 
         painter->fillRect(r, qApp->palette().base());
-        m_document.drawContents(painter);
+        m_renderer->paint(painter);
 
         if(state & DisassemblerBlockItem::Selected)
             painter->setPen(QPen(qApp->palette().color(QPalette::Highlight), 2.0));
@@ -114,12 +146,38 @@ void DisassemblerBlockItem::render(QPainter *painter, size_t state)
     painter->restore();
 }
 
-void DisassemblerBlockItem::setupDocument()
+void DisassemblerBlockItem::renderSummary(QPainter *painter, size_t state)
 {
-    QTextOption textoption;
-    textoption.setWrapMode(QTextOption::NoWrap);
+    QRect r = this->rect().adjusted(BLOCK_MARGINS);
+
+    painter->fillRect(r, qApp->palette().base());
+
+    QPen pen;
+    pen.setCosmetic(true); // Same thickness at every zoom level
+
+    if(state & DisassemblerBlockItem::Selected)
+    {
+        pen.setColor(qApp->palette().color(QPalette::Highlight));
+        pen.setWidth(2);
+    }
+    else
+        pen.setColor(qApp->palette().color(QPalette::WindowText));
 
-    m_document.setDefaultFont(REDasmSettings::font());
-    m_document.setDefaultTextOption(textoption);
-    m_document.setUndoRedoEnabled(false);
+    painter->setPen(pen);
+    painter->drawRect(r);
+
+    qreal scale = painter->transform().m11();
+    int titlesize = qRound(SUMMARY_TITLE_SIZE / scale);
+
+    if(m_title.isEmpty() || (titlesize > r.height())) // Too small to be read
+        return;
+
+    QFont font = painter->font();
+    font.setPixelSize(titlesize);
+
+    painter->save();
+        painter->setFont(font);
+        painter->setPen(qApp->palette().color(QPalette::WindowText));
+        painter->drawText(r, Qt::AlignLeft | Qt::AlignTop | Qt::TextSingleLine, m_title);
+    painter->restore();
 }
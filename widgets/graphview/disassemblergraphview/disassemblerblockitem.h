@@ -1,9 +1,8 @@
 #ifndef DISASSEMBLERBLOCKITEM_H
 #define DISASSEMBLERBLOCKITEM_H
 
-#include <QTextDocument>
 #include <redasm/graph/functiongraph.h>
-#include "../../../renderer/listingdocumentrenderer.h"
+#include "../../../renderer/listingblockrenderer.h"
 #include "../../../disassembleractions.h"
 #include "../graphviewitem.h"
 
@@ -14,13 +13,16 @@ class DisassemblerBlockItem : public GraphViewItem
     public:
         explicit DisassemblerBlockItem(const REDasm::Graphing::FunctionBasicBlock* fbb, const REDasm::DisassemblerPtr& disassembler, const REDasm::Graphing::Node& node, QWidget *parent = nullptr);
         virtual ~DisassemblerBlockItem();
+        void setBasicBlock(const REDasm::Graphing::FunctionBasicBlock* fbb, const REDasm::Graphing::Node& node);
+        void release();
         std::string currentWord();
-        ListingDocumentRenderer* renderer() const;
+        ListingBlockRenderer* renderer() const;
         bool containsIndex(s64 index) const;
 
     public:
         int currentLine() const override;
         void render(QPainter* painter, size_t state) override;
+        void renderSummary(QPainter* painter, size_t state) override;
         QSize size() const override;
 
     protected:
@@ -31,18 +33,18 @@ class DisassemblerBlockItem : public GraphViewItem
 
     private:
         QSize documentSize() const;
-        void setupDocument();
 
     signals:
         void followRequested(const QPointF& localpos);
 
     private:
         const REDasm::Graphing::FunctionBasicBlock* m_basicblock;
-        std::unique_ptr<ListingDocumentRenderer> m_renderer;
+        std::unique_ptr<ListingBlockRenderer> m_renderer;
         REDasm::DisassemblerPtr m_disassembler;
-        QTextDocument m_document;
-        qreal m_charheight;
-        QFont m_font;
+        std::string m_currentword;
+        QString m_title;
+        size_t m_lastline;
+        bool m_hadselection;
 };
 
 #endif // DISASSEMBLERBLOCKITEM_H
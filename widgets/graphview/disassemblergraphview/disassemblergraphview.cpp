@@ -8,8 +8,35 @@
 #include <QDebug>
 #include <QAction>
 
-DisassemblerGraphView::DisassemblerGraphView(QWidget *parent): GraphView(parent), m_currentfunction(nullptr)
+class DisassemblerGraphView::LayoutWorker: public QRunnable
 {
+    public:
+        LayoutWorker(const std::shared_ptr<LayoutJob>& job, DisassemblerGraphView* graphview): m_job(job), m_graphview(graphview) { }
+
+        void run() override
+        {
+            if(m_job->cancelled) // Superseded before it started
+                return;
+
+            REDasm::Graphing::Graph* graph = m_job->graph.get();
+            REDasm::Graphing::LayeredLayout ll(graph);
+            ll.execute(); // Not interruptible, a cancelled result is dropped
+
+            if(m_job->cancelled)
+                return;
+
+            m_job->layout.reset(GraphView::createLayout(graph));
+            QMetaObject::invokeMethod(m_graphview, "onLayoutCompleted", Qt::QueuedConnection, Q_ARG(u64, m_job->generation));
+        }
+
+    private:
+        std::shared_ptr<LayoutJob> m_job;
+        DisassemblerGraphView* m_graphview;
+};
+
+DisassemblerGraphView::DisassemblerGraphView(QWidget *parent): GraphView(parent), m_currentfunction(nullptr), m_layoutcache(GRAPH_LAYOUT_CACHE_SIZE), m_revision(0), m_layoutgeneration(0)
+{
+    m_layoutpool.setMaxThreadCount(1); // Superseded jobs are dropped, don't let them compete
     m_blinktimer = this->startTimer(CURSOR_BLINK_INTERVAL);
     this->setFocusPolicy(Qt::StrongFocus);
 
@@ -25,6 +52,10 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget *parent): GraphView(parent)
 DisassemblerGraphView::~DisassemblerGraphView()
 {
     EVENT_DISCONNECT(m_disassembler->document()->cursor(), positionChanged, this);
+    EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+
+    this->cancelLayout();
+    m_layoutpool.waitForDone();
 
     this->killTimer(m_blinktimer);
     m_blinktimer = -1;
@@ -43,6 +74,10 @@ void DisassemblerGraphView::setDisassembler(const REDasm::DisassemblerPtr &disas
         if(!this->hasFocus())
             this->focusCurrentBlock();
     });
+
+    EVENT_CONNECT(m_disassembler->document(), changed, this, [&](const REDasm::ListingDocumentChanged*) {
+        m_revision++; // Cached layouts are stale
+    });
 }
 
 bool DisassemblerGraphView::isCursorInGraph() const { return this->itemFromCurrentLine() != nullptr; }
@@ -58,30 +93,62 @@ std::string DisassemblerGraphView::currentWord()
 void DisassemblerGraphView::computeLayout()
 {
     m_disassembleractions->setCurrentRenderer(nullptr);
+    this->cancelLayout();
+
+    auto job = std::make_shared<LayoutJob>();
+    job->key = qMakePair(m_currentfunction->address, static_cast<u64>(m_revision));
+    job->generation = ++m_layoutgeneration;
+    job->cancelled = false;
 
     for(const auto& n : this->graph()->nodes())
     {
         const auto* fbb = static_cast<const REDasm::Graphing::FunctionGraph*>(this->graph())->data(n);
-        auto* dbi = new DisassemblerBlockItem(fbb, m_disassembler, n, this->viewport());
-        connect(dbi, &DisassemblerBlockItem::followRequested, this, &DisassemblerGraphView::onFollowRequested);
-        connect(dbi, &DisassemblerBlockItem::menuRequested, this, &DisassemblerGraphView::onMenuRequested);
-
+        DisassemblerBlockItem* dbi = this->acquireItem(fbb, n);
         m_items[n] = dbi;
-        this->graph()->width(n, dbi->width());
-        this->graph()->height(n, dbi->height());
     }
 
-    for(const auto& e : this->graph()->edges())
+    GraphLayout* layout = m_layoutcache.object(job->key);
+
+    if(layout)
+    {
+        this->applyLayout(layout);
+        this->focusCurrentBlock();
+        return;
+    }
+
     {
-        this->graph()->color(e, this->getEdgeColor(e).name().toStdString());
-        this->graph()->label(e, this->getEdgeLabel(e));
+        auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
+        job->graph = std::make_unique<REDasm::Graphing::Graph>(*this->graph()); // Nodes and edges only, block data stays in the document
     }
 
-    REDasm::Graphing::LayeredLayout ll(this->graph());
-    ll.execute();
+    for(auto it = m_items.begin(); it != m_items.end(); it++)
+    {
+        job->graph->width(it.key(), it.value()->width());
+        job->graph->height(it.key(), it.value()->height());
+    }
 
-    GraphView::computeLayout();
-    this->focusCurrentBlock();
+    for(const auto& e : job->graph->edges())
+    {
+        job->graph->color(e, this->getEdgeColor(e).name().toStdString());
+        job->graph->label(e, this->getEdgeLabel(e));
+    }
+
+    m_layoutjob = job;
+    this->setLayoutPending(true);
+    m_layoutpool.start(new LayoutWorker(job, this));
+}
+
+void DisassemblerGraphView::releaseItem(GraphViewItem *item)
+{
+    if(m_itempool.size() >= GRAPH_ITEM_POOL_SIZE)
+    {
+        GraphView::releaseItem(item);
+        return;
+    }
+
+    DisassemblerBlockItem* dbi = static_cast<DisassemblerBlockItem*>(item);
+    dbi->release();
+    m_itempool.push_back(dbi);
 }
 
 void DisassemblerGraphView::onFollowRequested(const QPointF& localpos)
@@ -103,6 +170,21 @@ void DisassemblerGraphView::onMenuRequested()
     m_disassembleractions->popup(QCursor::pos());
 }
 
+void DisassemblerGraphView::onLayoutCompleted(u64 generation)
+{
+    if(!m_layoutjob || (m_layoutjob->generation != generation))
+        return;
+
+    std::shared_ptr<LayoutJob> job = m_layoutjob;
+    m_layoutjob.reset();
+
+    GraphLayout* layout = job->layout.release();
+    m_layoutcache.insert(job->key, layout); // Takes ownership
+
+    this->applyLayout(layout);
+    this->focusCurrentBlock();
+}
+
 void DisassemblerGraphView::goTo(address_t address)
 {
     auto& document = m_disassembler->document();
@@ -112,6 +194,9 @@ void DisassemblerGraphView::goTo(address_t address)
 
 void DisassemblerGraphView::focusCurrentBlock()
 {
+    if(this->isLayoutPending())
+        return;
+
     GraphViewItem* item = this->itemFromCurrentLine();
 
     if(!item)
@@ -200,7 +285,7 @@ void DisassemblerGraphView::selectedItemChangedEvent()
 QColor DisassemblerGraphView::getEdgeColor(const REDasm::Graphing::Edge &e) const
 {
     const REDasm::Graphing::FunctionBasicBlock* fbb = static_cast<const REDasm::Graphing::FunctionGraph*>(this->graph())->data(e.source);
-    return THEME_VALUE(QString::fromStdString(fbb->style(e.target)));
+    return THEME_STYLE(THEME_STYLE_ID(fbb->style(e.target))).color;
 }
 
 std::string DisassemblerGraphView::getEdgeLabel(const REDasm::Graphing::Edge &e) const
@@ -228,6 +313,14 @@ std::string DisassemblerGraphView::getEdgeLabel(const REDasm::Graphing::Edge &e)
     return label;
 }
 
+void DisassemblerGraphView::cancelLayout()
+{
+    if(m_layoutjob)
+        m_layoutjob->cancelled = true;
+
+    m_layoutjob.reset();
+}
+
 GraphViewItem *DisassemblerGraphView::itemFromCurrentLine() const
 {
     const REDasm::ListingCursor* cursor = m_disassembler->document()->cursor();
@@ -268,3 +361,18 @@ void DisassemblerGraphView::mouseMoveEvent(QMouseEvent *e)
     if(item)
         m_disassembler->document()->cursor()->enable();
 }
+
+DisassemblerBlockItem *DisassemblerGraphView::acquireItem(const REDasm::Graphing::FunctionBasicBlock *fbb, const REDasm::Graphing::Node &n)
+{
+    if(!m_itempool.empty())
+    {
+        DisassemblerBlockItem* dbi = m_itempool.takeLast();
+        dbi->setBasicBlock(fbb, n);
+        return dbi;
+    }
+
+    auto* dbi = new DisassemblerBlockItem(fbb, m_disassembler, n, this->viewport());
+    connect(dbi, &DisassemblerBlockItem::followRequested, this, &DisassemblerGraphView::onFollowRequested);
+    connect(dbi, &DisassemblerBlockItem::menuRequested, this, &DisassemblerGraphView::onMenuRequested);
+    return dbi;
+}
@@ -2,15 +2,35 @@
 #define DISASSEMBLERGRAPHVIEW_H
 
 #include <QAbstractScrollArea>
+#include <QThreadPool>
+#include <QCache>
 #include <QList>
+#include <atomic>
+#include <memory>
 #include <redasm/graph/functiongraph.h>
 #include "disassemblerblockitem.h"
 #include "../graphview.h"
 
+#define GRAPH_LAYOUT_CACHE_SIZE 32   // Functions
+#define GRAPH_ITEM_POOL_SIZE    128  // Released blocks kept for the next graph, about a large function
+
 class DisassemblerGraphView : public GraphView
 {
     Q_OBJECT
 
+    private:
+        typedef QPair<address_t, u64> LayoutKey; // Function address, document revision
+
+        struct LayoutJob {
+            std::unique_ptr<REDasm::Graphing::Graph> graph; // Private copy, the document may rebuild or free its graphs meanwhile
+            std::unique_ptr<GraphLayout> layout;
+            LayoutKey key;
+            u64 generation;
+            std::atomic_bool cancelled;
+        };
+
+        class LayoutWorker;
+
     public:
         explicit DisassemblerGraphView(QWidget *parent = nullptr);
         virtual ~DisassemblerGraphView();
@@ -27,6 +47,8 @@ class DisassemblerGraphView : public GraphView
         QColor getEdgeColor(const REDasm::Graphing::Edge &e) const;
         std::string getEdgeLabel(const REDasm::Graphing::Edge &e) const;
         GraphViewItem* itemFromCurrentLine() const;
+        DisassemblerBlockItem* acquireItem(const REDasm::Graphing::FunctionBasicBlock* fbb, const REDasm::Graphing::Node& n);
+        void cancelLayout();
 
     protected:
         void mousePressEvent(QMouseEvent *e) override;
@@ -37,10 +59,12 @@ class DisassemblerGraphView : public GraphView
         void timerEvent(QTimerEvent* e) override;
         void selectedItemChangedEvent() override;
         void computeLayout() override;
+        void releaseItem(GraphViewItem* item) override;
 
     private slots:
         void onFollowRequested(const QPointF &localpos);
         void onMenuRequested();
+        void onLayoutCompleted(u64 generation);
 
     signals:
         void switchView();
@@ -54,6 +78,12 @@ class DisassemblerGraphView : public GraphView
     private:
         const REDasm::ListingItem* m_currentfunction;
         DisassemblerActions* m_disassembleractions;
+        QThreadPool m_layoutpool;
+        QCache<LayoutKey, GraphLayout> m_layoutcache;
+        std::shared_ptr<LayoutJob> m_layoutjob;
+        QList<DisassemblerBlockItem*> m_itempool;
+        std::atomic<u64> m_revision;
+        u64 m_layoutgeneration;
         int m_blinktimer;
 };
 
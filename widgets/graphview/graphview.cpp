@@ -1,10 +1,20 @@
 #include "graphview.h"
+#include "../../redasmsettings.h"
 #include <QMouseEvent>
 #include <QScrollBar>
 #include <QPainter>
 #include <QDebug>
+#include <algorithm>
+#include <memory>
 
-GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(nullptr), m_selecteditem(nullptr), m_focusonselection(false)
+#define GRAPH_THUMBNAIL_MAX_SIZE 4096
+#define GRAPH_TILE_SIZE          256
+#define GRAPH_TILE_MARGIN        16           // Drop shadows and block margins, in scene units
+#define GRAPH_TILE_CACHE_SIZE    (128 * 1024) // KiB
+
+#define TILE_KEY(tx, ty) ((static_cast<quint64>(static_cast<quint32>(tx)) << 32) | static_cast<quint32>(ty))
+
+GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembler(nullptr), m_selecteditem(nullptr), m_tiles(GRAPH_TILE_CACHE_SIZE), m_focusonselection(false)
 {
     m_prevscalefactor = m_scaledirection = 0;
     m_scalemax = 5.0;
@@ -12,7 +22,13 @@ GraphView::GraphView(QWidget *parent): QAbstractScrollArea(parent), m_disassembl
     m_scalestep = 0.1;
     m_viewportready = false;
     m_scrollmode = true;
+    m_layoutpending = false;
     m_scalemin = 0;
+    m_tilescale = 0;
+
+    REDasmSettings settings;
+    m_detailscale = settings.graphDetailScale();
+    m_thumbnailscale = settings.graphThumbnailScale();
 
     QPalette palette = this->palette();
     palette.setColor(QPalette::Base, THEME_VALUE("graph_bg"));
@@ -29,10 +45,21 @@ void GraphView::setGraph(REDasm::Graphing::Graph *graph)
 {
     m_selecteditem = nullptr;
     m_scalefactor = m_scaleboost = 1.0;
-    qDeleteAll(m_items);
+
+    for(GraphViewItem* item : m_items)
+    {
+        disconnect(item, &GraphViewItem::invalidated, this->viewport(), nullptr);
+        this->releaseItem(item);
+    }
+
     m_items.clear();
     m_lines.clear();
     m_arrows.clear();
+    m_edgestyles.clear();
+    m_styles.clear();
+    m_index.clear();
+    m_tiles.clear();
+    m_thumbnail = QPixmap();
 
     m_graph = graph;
     this->computeLayout();
@@ -49,7 +76,10 @@ void GraphView::setSelectedBlock(GraphViewItem *item)
         m_selecteditem = item;
         this->focusSelectedBlock();
         if (changed)
+        {
+            this->invalidateTiles();
             this->selectedItemChangedEvent();
+        }
         break;
     }
 }
@@ -58,6 +88,23 @@ void GraphView::setFocusOnSelection(bool b) { m_focusonselection = b; }
 GraphViewItem *GraphView::selectedItem() const { return m_selecteditem; }
 REDasm::Graphing::Graph *GraphView::graph() const { return m_graph; }
 
+GraphLayout *GraphView::createLayout(REDasm::Graphing::Graph *graph)
+{
+    GraphLayout* layout = new GraphLayout();
+    layout->areasize = QSize(graph->areaWidth(), graph->areaHeight());
+
+    for(const auto& n : graph->nodes())
+        layout->positions[n] = QPoint(graph->x(n), graph->y(n));
+
+    for(const auto& e : graph->edges())
+    {
+        GraphView::precomputeLine(graph, e, layout);
+        GraphView::precomputeArrow(graph, e, layout);
+    }
+
+    return layout;
+}
+
 void GraphView::focusSelectedBlock()
 {
     if(m_selecteditem)
@@ -95,6 +142,47 @@ void GraphView::focusBlock(const GraphViewItem *item, bool force)
     }
 }
 
+void GraphView::applyLayout(const GraphLayout *layout)
+{
+    for(auto it = m_items.begin(); it != m_items.end(); it++)
+    {
+        it.value()->move(layout->positions.value(it.key()));
+        GraphViewItem* item = it.value();
+        connect(item, &GraphViewItem::invalidated, this->viewport(), [=]() { this->invalidateTiles(item->rect()); });
+    }
+
+    m_lines = layout->lines;
+    m_arrows = layout->arrows;
+    m_edgestyles = layout->edgestyles;
+    m_styles = layout->styles;
+    m_areasize = layout->areasize;
+    m_index.build(m_items.values(), m_lines, m_arrows);
+    m_tiles.clear();
+    m_thumbnail = QPixmap();
+
+    QSize areasize;
+
+    if(m_viewportready)
+        areasize = this->viewport()->size();
+    else
+        areasize = this->parentWidget()->size() - QSize(20, 20);
+
+    qreal sx = static_cast<qreal>(areasize.width()) / static_cast<qreal>(this->width());
+    qreal sy = static_cast<qreal>(areasize.height()) / static_cast<qreal>(this->height());
+    m_scalemin = std::min(static_cast<qreal>(std::min(sx, sy) * (1 - m_scalestep)), 0.05); // If graph is very large...
+
+    this->setLayoutPending(false);
+    this->adjustSize(areasize.width(), areasize.height());
+}
+
+void GraphView::setLayoutPending(bool pending)
+{
+    m_layoutpending = pending;
+    this->viewport()->update();
+}
+
+bool GraphView::isLayoutPending() const { return m_layoutpending; }
+
 void GraphView::mouseDoubleClickEvent(QMouseEvent* e)
 {
     bool updated = this->updateSelectedItem(e);
@@ -196,62 +284,30 @@ void GraphView::resizeEvent(QResizeEvent *e) { this->adjustSize(e->size().width(
 
 void GraphView::paintEvent(QPaintEvent *e)
 {
+    if(m_layoutpending)
+    {
+        QPainter painter(this->viewport());
+        painter.drawText(this->viewport()->rect(), Qt::AlignCenter, "Computing layout...");
+        return;
+    }
+
     QPoint translation = { m_renderoffset.x() - this->horizontalScrollBar()->value(),
                            m_renderoffset.y() - this->verticalScrollBar()->value() };
 
     QPainter painter(this->viewport());
-    painter.translate(translation);
-    painter.scale(m_scalefactor, m_scalefactor);
 
-    QRect vpr(this->viewport()->rect().topLeft(), this->viewport()->rect().bottomRight() - QPoint(1, 1));
-
-    // Adjust imaginary viewport rect at new zoom level
-    vpr.setWidth(vpr.width() / m_scalefactor);
-    vpr.setHeight(vpr.height() / m_scalefactor);
-    vpr.translate(-translation.x() / m_scalefactor, -translation.y() / m_scalefactor);
-
-    // Render edges
-    painter.save();
-
-    for(auto it = m_lines.begin(); it != m_lines.end(); it++)
+    if(m_scalefactor >= m_thumbnailscale)
     {
-        QColor c(QString::fromStdString(m_graph->color(it->first)));
-        QPen pen(c);
-
-        if(m_selecteditem && ((it->first.source == m_selecteditem->node()) || (it->first.target == m_selecteditem->node())))
-        {
-            pen.setWidthF(2.0 / m_scalefactor);
-        }
-        else
-        {
-            pen.setWidthF(1.0 / m_scalefactor);
-            pen.setStyle(m_selecteditem ? Qt::DashLine : Qt::SolidLine);
-        }
-
-        painter.setPen(pen);
-        painter.setBrush(c);
-        painter.drawLines(it->second);
-
-        pen.setStyle(Qt::SolidLine);
-        painter.setPen(pen);
-        painter.drawConvexPolygon(m_arrows[it->first]);
+        this->renderTiles(&painter, translation);
+        return;
     }
 
-    painter.restore();
-
-    // Render nodes
-    for(auto* item : m_items)
-    {
-        if(!vpr.intersects(item->rect())) // Ignore blocks that are not in view
-            continue;
-
-        size_t itemstate = GraphViewItem::None;
-
-        if(m_selecteditem == item)
-            itemstate |= GraphViewItem::Selected;
+    painter.translate(translation);
+    painter.scale(m_scalefactor, m_scalefactor);
+    this->renderThumbnail(&painter);
 
-        item->render(&painter, itemstate);
-    }
+    if(m_selecteditem) // Selection isn't part of the cached image
+        m_selecteditem->renderSummary(&painter, GraphViewItem::Selected);
 }
 
 void GraphView::showEvent(QShowEvent *e)
@@ -272,35 +328,17 @@ void GraphView::selectedItemChangedEvent()
 
 void GraphView::computeLayout()
 {
-    for(const auto& n : m_graph->nodes())
-    {
-        m_items[n]->move(QPoint(m_graph->x(n), m_graph->y(n)));
-        connect(m_items[n], &GraphViewItem::invalidated, this->viewport(), [&]() { this->viewport()->update(); });
-    }
-
-    for(const auto& e : m_graph->edges())
-    {
-        this->precomputeLine(e);
-        this->precomputeArrow(e);
-    }
-
-    QSize areasize;
-
-    if(m_viewportready)
-        areasize = this->viewport()->size();
-    else
-        areasize = this->parentWidget()->size() - QSize(20, 20);
-
-    qreal sx = static_cast<qreal>(areasize.width()) / static_cast<qreal>(this->width());
-    qreal sy = static_cast<qreal>(areasize.height()) / static_cast<qreal>(this->height());
-    m_scalemin = std::min(static_cast<qreal>(std::min(sx, sy) * (1 - m_scalestep)), 0.05); // If graph is very large...
-
-    this->adjustSize(areasize.width(), areasize.height());
-    this->viewport()->update();
+    std::unique_ptr<GraphLayout> layout(GraphView::createLayout(m_graph)); // Graph is already laid out
+    this->applyLayout(layout.get());
 }
 
+void GraphView::releaseItem(GraphViewItem *item) { delete item; }
+
 GraphViewItem *GraphView::itemFromMouseEvent(QMouseEvent *e) const
 {
+    if(m_layoutpending)
+        return nullptr;
+
     //Convert coordinates to system used in blocks
     int xofs = this->horizontalScrollBar()->value();
     int yofs = this->verticalScrollBar()->value();
@@ -308,16 +346,12 @@ GraphViewItem *GraphView::itemFromMouseEvent(QMouseEvent *e) const
     QPoint pos = { static_cast<int>(std::floor((e->x() + xofs - m_renderoffset.x()) / m_scalefactor)),
                    static_cast<int>(std::floor((e->y() + yofs - m_renderoffset.y()) / m_scalefactor)) };
 
-    for(GraphViewItem* item : m_items)
-    {
-        if(!item->contains(pos))
-            continue;
+    GraphViewItem* item = m_index.itemAt(pos);
 
+    if(item)
         e->setLocalPos(item->mapToItem(pos));
-        return item;
-    }
 
-    return nullptr;
+    return item;
 }
 
 void GraphView::zoomOut(const QPoint &cursorpos)
@@ -360,7 +394,7 @@ void GraphView::adjustSize(int vpw, int vph, const QPoint &cursorpos, bool fit)
     if(vph < 30)
         return;
 
-    m_rendersize = QSize(m_graph->areaWidth() * m_scalefactor, m_graph->areaHeight() * m_scalefactor);
+    m_rendersize = QSize(m_areasize.width() * m_scalefactor, m_areasize.height() * m_scalefactor);
     m_renderoffset = QPoint(vpw, vph);
 
     QSize scrollrange = { m_rendersize.width() + vpw, m_rendersize.height() + vph };
@@ -397,9 +431,9 @@ void GraphView::adjustSize(int vpw, int vph, const QPoint &cursorpos, bool fit)
     }
 }
 
-void GraphView::precomputeArrow(const REDasm::Graphing::Edge &e)
+void GraphView::precomputeArrow(REDasm::Graphing::Graph *graph, const REDasm::Graphing::Edge &e, GraphLayout *layout)
 {
-    const REDasm::Graphing::Polyline& path = m_graph->arrow(e);
+    const REDasm::Graphing::Polyline& path = graph->arrow(e);
     QPolygon arrowhead;
 
     for(int i = 0; i < path.size(); i++)
@@ -408,12 +442,12 @@ void GraphView::precomputeArrow(const REDasm::Graphing::Edge &e)
         arrowhead << QPoint(p1.x, p1.y);
     }
 
-    m_arrows[e] = arrowhead;
+    layout->arrows[e] = arrowhead;
 }
 
-void GraphView::precomputeLine(const REDasm::Graphing::Edge &e)
+void GraphView::precomputeLine(REDasm::Graphing::Graph *graph, const REDasm::Graphing::Edge &e, GraphLayout *layout)
 {
-    const REDasm::Graphing::Polyline& path = m_graph->routes(e);
+    const REDasm::Graphing::Polyline& path = graph->routes(e);
 
     QVector<QLine> lines;
 
@@ -424,7 +458,29 @@ void GraphView::precomputeLine(const REDasm::Graphing::Edge &e)
         lines.push_back(QLine(p1.x, p1.y, p2.x, p2.y));
     }
 
-    m_lines[e] = lines;
+    layout->lines[e] = lines;
+
+    QColor c(QString::fromStdString(graph->color(e)));
+    auto it = std::find_if(layout->styles.begin(), layout->styles.end(), [&](const GraphEdgeStyle& style) -> bool { return style.color == c; });
+
+    if(it != layout->styles.end()) // Edges share a handful of colors
+    {
+        layout->edgestyles[e] = std::distance(layout->styles.begin(), it);
+        return;
+    }
+
+    GraphEdgeStyle style;
+    style.color = c;
+    style.brush = QBrush(c);
+    style.pen = QPen(c, 0);
+    style.pen.setCosmetic(true);
+    style.dashpen = style.pen;
+    style.dashpen.setStyle(Qt::DashLine);
+    style.selectedpen = QPen(c, 2.0);
+    style.selectedpen.setCosmetic(true);
+
+    layout->edgestyles[e] = layout->styles.size();
+    layout->styles.push_back(style);
 }
 
 bool GraphView::updateSelectedItem(QMouseEvent *e)
@@ -432,6 +488,9 @@ bool GraphView::updateSelectedItem(QMouseEvent *e)
     GraphViewItem* olditem = m_selecteditem;
     m_selecteditem = this->itemFromMouseEvent(e);
 
+    if(olditem != m_selecteditem) // Edges of the whole scene depend on the selection
+        this->invalidateTiles();
+
     if(olditem)
     {
         olditem->itemSelectionChanged(false);
@@ -443,3 +502,191 @@ bool GraphView::updateSelectedItem(QMouseEvent *e)
 
     return olditem != m_selecteditem;
 }
+
+void GraphView::renderEdges(QPainter *painter, const QRect &vpr, bool detailed)
+{
+    QVector< QVector<QLine> > lines(m_styles.size()), selectedlines(m_styles.size());
+    QVector< QVector<const QPolygon*> > arrows(m_styles.size()), selectedarrows(m_styles.size());
+
+    for(const REDasm::Graphing::Edge* e : m_index.edges(vpr)) // Group by style, selected edges go on top
+    {
+        int styleidx = m_edgestyles.at(*e);
+        bool selected = detailed && m_selecteditem && ((e->source == m_selecteditem->node()) || (e->target == m_selecteditem->node()));
+
+        (selected ? selectedlines : lines)[styleidx] += m_lines.at(*e);
+
+        if(detailed) // Arrowheads aren't visible at lower zoom levels
+            (selected ? selectedarrows : arrows)[styleidx].push_back(&m_arrows.at(*e));
+    }
+
+    painter->save();
+
+    for(int i = 0; i < m_styles.size(); i++)
+    {
+        const GraphEdgeStyle& style = m_styles[i];
+
+        if(!lines[i].empty())
+        {
+            painter->setPen((detailed && m_selecteditem) ? style.dashpen : style.pen);
+            painter->drawLines(lines[i]);
+        }
+
+        if(arrows[i].empty())
+            continue;
+
+        painter->setPen(style.pen);
+        painter->setBrush(style.brush);
+
+        for(const QPolygon* arrow : arrows[i])
+            painter->drawConvexPolygon(*arrow);
+    }
+
+    for(int i = 0; i < m_styles.size(); i++) // Selection overlay
+    {
+        const GraphEdgeStyle& style = m_styles[i];
+
+        if(selectedlines[i].empty())
+            continue;
+
+        painter->setPen(style.selectedpen);
+        painter->setBrush(style.brush);
+        painter->drawLines(selectedlines[i]);
+
+        for(const QPolygon* arrow : selectedarrows[i])
+            painter->drawConvexPolygon(*arrow);
+    }
+
+    painter->restore();
+}
+
+void GraphView::renderItems(QPainter *painter, const QRect &vpr, bool detailed)
+{
+    for(auto* item : m_index.items(vpr)) // Blocks that are not in view aren't returned
+    {
+        size_t itemstate = GraphViewItem::None;
+
+        if(m_selecteditem == item)
+            itemstate |= GraphViewItem::Selected;
+
+        if(detailed)
+            item->render(painter, itemstate);
+        else
+            item->renderSummary(painter, itemstate);
+    }
+}
+
+void GraphView::renderThumbnail(QPainter *painter)
+{
+    if(m_areasize.isEmpty())
+        return;
+
+    if(m_thumbnail.isNull())
+    {
+        qreal scale = std::min(m_thumbnailscale, static_cast<qreal>(GRAPH_THUMBNAIL_MAX_SIZE) / std::max(m_areasize.width(), m_areasize.height()));
+        QSize size(std::max(1, qRound(m_areasize.width() * scale)), std::max(1, qRound(m_areasize.height() * scale)));
+
+        m_thumbnail = QPixmap(size);
+        m_thumbnail.fill(this->palette().color(QPalette::Base));
+
+        QPainter thumbpainter(&m_thumbnail);
+        thumbpainter.setRenderHint(QPainter::Antialiasing);
+        thumbpainter.scale(scale, scale);
+
+        this->renderEdges(&thumbpainter, QRect(QPoint(0, 0), m_areasize), false);
+
+        for(auto* item : m_items) // Selection is painted over the thumbnail
+            item->renderSummary(&thumbpainter, GraphViewItem::None);
+    }
+
+    painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+        painter->drawPixmap(QRect(QPoint(0, 0), m_areasize), m_thumbnail);
+    painter->restore();
+}
+
+void GraphView::renderTiles(QPainter *painter, const QPoint &translation)
+{
+    if(m_tilescale != m_scalefactor) // Tiles are valid for one zoom level only
+    {
+        m_tiles.clear();
+        m_tilescale = m_scalefactor;
+    }
+
+    QRect scenerect(0, 0, std::ceil(m_areasize.width() * m_scalefactor), std::ceil(m_areasize.height() * m_scalefactor));
+    QRect r = this->viewport()->rect().translated(-translation).intersected(scenerect);
+
+    if(r.isEmpty())
+        return;
+
+    int tx1 = r.left() / GRAPH_TILE_SIZE, tx2 = r.right() / GRAPH_TILE_SIZE;
+    int ty1 = r.top() / GRAPH_TILE_SIZE, ty2 = r.bottom() / GRAPH_TILE_SIZE;
+
+    for(int ty = ty1; ty <= ty2; ty++)
+    {
+        for(int tx = tx1; tx <= tx2; tx++)
+        {
+            QPixmap* cachedtile = m_tiles.object(TILE_KEY(tx, ty));
+            QPixmap tile;
+
+            if(cachedtile)
+                tile = *cachedtile;
+            else
+            {
+                tile = this->renderTile(tx, ty);
+                m_tiles.insert(TILE_KEY(tx, ty), new QPixmap(tile), (tile.width() * tile.height() * tile.depth()) / (8 * 1024));
+            }
+
+            painter->drawPixmap(translation.x() + (tx * GRAPH_TILE_SIZE), translation.y() + (ty * GRAPH_TILE_SIZE), tile);
+        }
+    }
+}
+
+QPixmap GraphView::renderTile(int tx, int ty)
+{
+    qreal dpr = this->devicePixelRatioF();
+    QPixmap tile(std::ceil(GRAPH_TILE_SIZE * dpr), std::ceil(GRAPH_TILE_SIZE * dpr));
+    tile.setDevicePixelRatio(dpr);
+    tile.fill(this->palette().color(QPalette::Base));
+
+    QPainter painter(&tile);
+    painter.translate(-tx * GRAPH_TILE_SIZE, -ty * GRAPH_TILE_SIZE);
+    painter.scale(m_scalefactor, m_scalefactor);
+
+    // Pick everything that can bleed into this tile
+    int margin = GRAPH_TILE_MARGIN + std::ceil(2 / m_scalefactor);
+    QRect r = QRectF((tx * GRAPH_TILE_SIZE) / m_scalefactor, (ty * GRAPH_TILE_SIZE) / m_scalefactor,
+                     GRAPH_TILE_SIZE / m_scalefactor, GRAPH_TILE_SIZE / m_scalefactor).toAlignedRect();
+
+    r.adjust(-margin, -margin, margin, margin);
+
+    bool detailed = m_scalefactor >= m_detailscale;
+    this->renderEdges(&painter, r, detailed);
+    this->renderItems(&painter, r, detailed);
+    return tile;
+}
+
+void GraphView::invalidateTiles(const QRect &r)
+{
+    if(m_tilescale > 0)
+    {
+        QRect m = r.adjusted(-GRAPH_TILE_MARGIN, -GRAPH_TILE_MARGIN, GRAPH_TILE_MARGIN, GRAPH_TILE_MARGIN);
+        QRect scaled = QRectF(QPointF(m.topLeft()) * m_tilescale, QPointF(m.bottomRight()) * m_tilescale).toAlignedRect();
+
+        int tx1 = std::floor(static_cast<qreal>(scaled.left()) / GRAPH_TILE_SIZE), tx2 = std::floor(static_cast<qreal>(scaled.right()) / GRAPH_TILE_SIZE);
+        int ty1 = std::floor(static_cast<qreal>(scaled.top()) / GRAPH_TILE_SIZE), ty2 = std::floor(static_cast<qreal>(scaled.bottom()) / GRAPH_TILE_SIZE);
+
+        for(int ty = ty1; ty <= ty2; ty++)
+        {
+            for(int tx = tx1; tx <= tx2; tx++)
+                m_tiles.remove(TILE_KEY(tx, ty));
+        }
+    }
+
+    this->viewport()->update();
+}
+
+void GraphView::invalidateTiles()
+{
+    m_tiles.clear();
+    this->viewport()->update();
+}
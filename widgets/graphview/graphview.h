@@ -6,13 +6,34 @@
 // - https://github.com/x64dbg/x64dbg/blob/development/src/gui/Src/Gui/DisassemblerGraphView.cpp
 
 #include <QAbstractScrollArea>
+#include <QPixmap>
+#include <QCache>
+#include <QPen>
 #include <QVector>
 #include <QList>
 #include <redasm/disassembler/disassemblerapi.h>
 #include <redasm/graph/graph.h>
 #include "../../../themeprovider.h"
+#include "graphviewindex.h"
 #include "graphviewitem.h"
 
+struct GraphEdgeStyle
+{
+    QColor color;
+    QPen pen, dashpen, selectedpen; // Cosmetic, same thickness at every zoom level
+    QBrush brush;
+};
+
+struct GraphLayout
+{
+    QHash<REDasm::Graphing::Node, QPoint> positions;
+    std::unordered_map< REDasm::Graphing::Edge, QVector<QLine> > lines;
+    std::unordered_map<REDasm::Graphing::Edge, QPolygon> arrows;
+    std::unordered_map<REDasm::Graphing::Edge, int> edgestyles;
+    QVector<GraphEdgeStyle> styles;
+    QSize areasize;
+};
+
 class GraphView : public QAbstractScrollArea
 {
     Q_OBJECT
@@ -26,11 +47,17 @@ class GraphView : public QAbstractScrollArea
         GraphViewItem* selectedItem() const;
         REDasm::Graphing::Graph* graph() const;
 
+    public:
+        static GraphLayout* createLayout(REDasm::Graphing::Graph* graph);
+
     public slots:
         void focusSelectedBlock();
 
     protected:
         void focusBlock(const GraphViewItem* item, bool force = false);
+        void applyLayout(const GraphLayout* layout);
+        void setLayoutPending(bool pending);
+        bool isLayoutPending() const;
 
     protected:
         void mouseDoubleClickEvent(QMouseEvent* e) override;
@@ -43,15 +70,23 @@ class GraphView : public QAbstractScrollArea
         void showEvent(QShowEvent* e) override;
         virtual void selectedItemChangedEvent();
         virtual void computeLayout();
+        virtual void releaseItem(GraphViewItem* item);
 
     private:
         GraphViewItem* itemFromMouseEvent(QMouseEvent *e) const;
         void zoomOut(const QPoint& cursorpos);
         void zoomIn(const QPoint& cursorpos);
         void adjustSize(int vpw, int vph, const QPoint& cursorpos = QPoint(), bool fit = false);
-        void precomputeArrow(const REDasm::Graphing::Edge& e);
-        void precomputeLine(const REDasm::Graphing::Edge& e);
+        static void precomputeArrow(REDasm::Graphing::Graph* graph, const REDasm::Graphing::Edge& e, GraphLayout* layout);
+        static void precomputeLine(REDasm::Graphing::Graph* graph, const REDasm::Graphing::Edge& e, GraphLayout* layout);
         bool updateSelectedItem(QMouseEvent* e);
+        void renderEdges(QPainter* painter, const QRect& vpr, bool detailed);
+        void renderItems(QPainter* painter, const QRect& vpr, bool detailed);
+        void renderThumbnail(QPainter* painter);
+        void renderTiles(QPainter* painter, const QPoint& translation);
+        QPixmap renderTile(int tx, int ty);
+        void invalidateTiles(const QRect& r);
+        void invalidateTiles();
 
     protected:
         REDasm::DisassemblerPtr m_disassembler;
@@ -65,12 +100,19 @@ class GraphView : public QAbstractScrollArea
         REDasm::Graphing::Graph* m_graph;
         std::unordered_map< REDasm::Graphing::Edge, QVector<QLine> > m_lines;
         std::unordered_map<REDasm::Graphing::Edge, QPolygon> m_arrows;
+        std::unordered_map<REDasm::Graphing::Edge, int> m_edgestyles;
+        QVector<GraphEdgeStyle> m_styles;
+        GraphViewIndex m_index;
+        QCache<quint64, QPixmap> m_tiles; // Scene rendered at m_tilescale, in GRAPH_TILE_SIZE squares
+        QPixmap m_thumbnail;
         QPoint m_renderoffset, m_scrollbase;
-        QSize m_rendersize;
+        QSize m_rendersize, m_areasize;
         qreal m_scalefactor, m_scalestep, m_prevscalefactor;
         qreal m_scalemin, m_scalemax;
+        qreal m_detailscale, m_thumbnailscale; // Level of detail thresholds
+        qreal m_tilescale;
         int m_scaledirection, m_scaleboost;
-        bool m_viewportready, m_scrollmode;
+        bool m_viewportready, m_scrollmode, m_layoutpending;
 
     private:
         bool m_focusonselection;
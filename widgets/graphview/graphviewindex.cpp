@@ -0,0 +1,148 @@
+#include "graphviewindex.h"
+#include <algorithm>
+#include <cmath>
+
+#define GRAPH_INDEX_MIN_CELL_SIZE 32
+
+GraphViewIndex::GraphViewIndex(): m_cellsize(GRAPH_INDEX_MIN_CELL_SIZE) { }
+
+void GraphViewIndex::clear()
+{
+    m_items.clear();
+    m_edges.clear();
+    m_itemcells.clear();
+    m_edgecells.clear();
+    m_cellsize = GRAPH_INDEX_MIN_CELL_SIZE;
+}
+
+void GraphViewIndex::build(const QList<GraphViewItem*>& items, const EdgeLines& lines, const EdgeArrows& arrows)
+{
+    this->clear();
+
+    if(!items.empty()) // About one block per cell
+    {
+        qint64 totalsize = 0;
+
+        for(const GraphViewItem* item : items)
+            totalsize += std::max(item->width(), item->height());
+
+        m_cellsize = std::max(GRAPH_INDEX_MIN_CELL_SIZE, static_cast<int>(totalsize / items.size()));
+    }
+
+    m_items.reserve(items.size());
+
+    for(GraphViewItem* item : items)
+    {
+        this->insert(&m_itemcells, item->rect(), m_items.size());
+        m_items.push_back(item);
+    }
+
+    m_edges.reserve(static_cast<int>(lines.size()));
+
+    for(auto it = lines.begin(); it != lines.end(); it++)
+    {
+        int id = m_edges.size();
+        m_edges.push_back(&it->first);
+
+        for(const QLine& line : it->second) // Routes are mostly orthogonal, bounding boxes are tight
+            this->insert(&m_edgecells, QRect(line.p1(), line.p2()).normalized(), id);
+
+        auto ait = arrows.find(it->first);
+
+        if(ait != arrows.end())
+            this->insert(&m_edgecells, ait->second.boundingRect(), id);
+    }
+}
+
+GraphViewItem *GraphViewIndex::itemAt(const QPoint &p) const
+{
+    auto it = m_itemcells.find(this->cellKey(static_cast<int>(std::floor(static_cast<double>(p.x()) / m_cellsize)),
+                                             static_cast<int>(std::floor(static_cast<double>(p.y()) / m_cellsize))));
+
+    if(it == m_itemcells.end())
+        return nullptr;
+
+    for(int id : it.value())
+    {
+        if(m_items[id]->contains(p))
+            return m_items[id];
+    }
+
+    return nullptr;
+}
+
+QVector<GraphViewItem *> GraphViewIndex::items(const QRect &r) const
+{
+    QVector<GraphViewItem*> result;
+
+    for(int id : this->query(m_itemcells, r))
+    {
+        if(r.intersects(m_items[id]->rect()))
+            result.push_back(m_items[id]);
+    }
+
+    return result;
+}
+
+QVector<const REDasm::Graphing::Edge *> GraphViewIndex::edges(const QRect &r) const
+{
+    QVector<const REDasm::Graphing::Edge*> result;
+
+    for(int id : this->query(m_edgecells, r))
+        result.push_back(m_edges[id]);
+
+    return result;
+}
+
+quint64 GraphViewIndex::cellKey(int cx, int cy) const { return (static_cast<quint64>(static_cast<quint32>(cx)) << 32) | static_cast<quint32>(cy); }
+
+QRect GraphViewIndex::cellRange(const QRect &r) const
+{
+    auto cell = [&](int v) -> int { return static_cast<int>(std::floor(static_cast<double>(v) / m_cellsize)); };
+    return QRect(QPoint(cell(r.left()), cell(r.top())), QPoint(cell(r.right()), cell(r.bottom())));
+}
+
+void GraphViewIndex::insert(QHash<quint64, QVector<int> >* cells, const QRect &r, int id)
+{
+    QRect range = this->cellRange(r);
+
+    for(int cy = range.top(); cy <= range.bottom(); cy++)
+    {
+        for(int cx = range.left(); cx <= range.right(); cx++)
+            (*cells)[this->cellKey(cx, cy)].push_back(id);
+    }
+}
+
+QVector<int> GraphViewIndex::query(const QHash<quint64, QVector<int> > &cells, const QRect &r) const
+{
+    QRect range = this->cellRange(r);
+    QVector<int> result;
+
+    if(static_cast<qint64>(range.width()) * range.height() > cells.size()) // Viewport larger than the graph: walk occupied cells only
+    {
+        for(auto it = cells.begin(); it != cells.end(); it++)
+        {
+            int cx = static_cast<qint32>(it.key() >> 32), cy = static_cast<qint32>(it.key() & 0xFFFFFFFF);
+
+            if(range.contains(cx, cy))
+                result += it.value();
+        }
+    }
+    else
+    {
+        for(int cy = range.top(); cy <= range.bottom(); cy++)
+        {
+            for(int cx = range.left(); cx <= range.right(); cx++)
+            {
+                auto it = cells.find(this->cellKey(cx, cy));
+
+                if(it != cells.end())
+                    result += it.value();
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end()); // Entries spanning several cells are reported once
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,40 @@
+#ifndef GRAPHVIEWINDEX_H
+#define GRAPHVIEWINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QRect>
+#include <QLine>
+#include <QPolygon>
+#include <unordered_map>
+#include <redasm/graph/graph.h>
+#include "graphviewitem.h"
+
+class GraphViewIndex // Uniform grid over blocks and edge segments
+{
+    public:
+        typedef std::unordered_map< REDasm::Graphing::Edge, QVector<QLine> > EdgeLines;
+        typedef std::unordered_map<REDasm::Graphing::Edge, QPolygon> EdgeArrows;
+
+    public:
+        GraphViewIndex();
+        void clear();
+        void build(const QList<GraphViewItem*>& items, const EdgeLines& lines, const EdgeArrows& arrows);
+        GraphViewItem* itemAt(const QPoint& p) const;
+        QVector<GraphViewItem*> items(const QRect& r) const;
+        QVector<const REDasm::Graphing::Edge*> edges(const QRect& r) const;
+
+    private:
+        quint64 cellKey(int cx, int cy) const;
+        QRect cellRange(const QRect& r) const;
+        void insert(QHash<quint64, QVector<int> >* cells, const QRect& r, int id);
+        QVector<int> query(const QHash<quint64, QVector<int> >& cells, const QRect& r) const;
+
+    private:
+        QVector<GraphViewItem*> m_items;
+        QVector<const REDasm::Graphing::Edge*> m_edges; // Keys of GraphView's lines, stable until the next layout
+        QHash<quint64, QVector<int> > m_itemcells, m_edgecells;
+        int m_cellsize;
+};
+
+#endif // GRAPHVIEWINDEX_H
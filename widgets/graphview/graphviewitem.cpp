@@ -11,10 +11,12 @@ QRect GraphViewItem::rect() const { return QRect(m_pos, this->size());  }
 bool GraphViewItem::contains(const QPoint &p) const { return this->rect().contains(p); }
 const QPoint &GraphViewItem::position() const { return m_pos; }
 void GraphViewItem::move(const QPoint &pos) { m_pos = pos; }
+void GraphViewItem::setNode(const REDasm::Graphing::Node &node) { m_node = node; }
 void GraphViewItem::itemSelectionChanged(bool selected) { }
 QPoint GraphViewItem::mapToItem(const QPoint &p) const { return QPoint(p.x() - m_pos.x(), p.y() - m_pos.y()); }
 int GraphViewItem::currentLine() const { return 0; }
 void GraphViewItem::mouseDoubleClickEvent(QMouseEvent *e) { }
 void GraphViewItem::mousePressEvent(QMouseEvent* e) { if(e->buttons() == Qt::RightButton) emit menuRequested();  }
 void GraphViewItem::mouseMoveEvent(QMouseEvent *e) { }
+void GraphViewItem::renderSummary(QPainter *painter, size_t) { painter->drawRect(this->rect()); }
 void GraphViewItem::invalidate(bool notify) { if(notify) emit invalidated(); }
@@ -29,6 +29,7 @@ class GraphViewItem: public QObject
         void move(const QPoint &pos);
 
     protected:
+        void setNode(const REDasm::Graphing::Node& node);
         virtual void itemSelectionChanged(bool selected);
         virtual void mouseDoubleClickEvent(QMouseEvent *e);
         virtual void mousePressEvent(QMouseEvent *e);
@@ -38,6 +39,7 @@ class GraphViewItem: public QObject
         QPoint mapToItem(const QPoint& p) const;
         virtual int currentLine() const;
         virtual void render(QPainter* painter, size_t state) = 0;
+        virtual void renderSummary(QPainter* painter, size_t state);
         virtual QSize size() const = 0;
 
     signals:
@@ -47,7 +49,7 @@ class GraphViewItem: public QObject
     private:
         QPoint m_pos;
 
-        const REDasm::Graphing::Node& m_node;
+        REDasm::Graphing::Node m_node; // Items can be recycled across graphs
 
     friend class GraphView;
 };
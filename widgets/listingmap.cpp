@@ -1,54 +1,172 @@
 #include "listingmap.h"
 #include "../themeprovider.h"
-#include <redasm/graph/functiongraph.h>
 #include <redasm/plugins/loader.h>
+#include <QContextMenuEvent>
+#include <QActionGroup>
 #include <QPainter>
+#include <QMenu>
+#include <algorithm>
 #include <cmath>
 
-#define LISTINGMAP_SIZE 64
+#define LISTINGMAP_SIZE      64
+#define HEATMAP_WINDOW_SIZE  4096
+#define HEATMAP_CHUNK_SIZE   1024 // Windows per worker, at least
 
-ListingMap::ListingMap(QWidget *parent) : QWidget(parent), m_disassembler(nullptr), m_orientation(Qt::Vertical), m_totalsize(0)
+class ListingMap::RasterWorker: public QRunnable
 {
+    public:
+        RasterWorker(const std::shared_ptr<RasterJob>& job, ListingMap* listingmap): m_job(job), m_listingmap(listingmap) { }
+
+        void run() override
+        {
+            if(m_job->cancelled) // Superseded before it started
+                return;
+
+            QImage image(m_job->metrics.size * m_job->pixelratio, QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(m_job->pixelratio);
+            image.fill(Qt::gray);
+
+            QPainter painter(&image);
+            painter.setPen(Qt::transparent);
+
+            if(m_job->heatmap)
+                ListingMap::renderHeatmap(&painter, m_job.get());
+            else
+                ListingMap::renderSegments(&painter, m_job.get());
+
+            if(m_job->functions)
+            {
+                auto lock = REDasm::s_lock_safe_ptr(m_job->disassembler->document());
+
+                for(const REDasm::ListingItem* item : lock->functions())
+                {
+                    if(m_job->cancelled)
+                        return;
+
+                    ListingMap::renderFunction(&painter, m_job.get(), lock->symbol(item->address), lock->functions().graph(item));
+                }
+            }
+
+            painter.end();
+            m_job->image = image;
+            QMetaObject::invokeMethod(m_listingmap, "onRasterCompleted", Qt::QueuedConnection, Q_ARG(u64, m_job->generation));
+        }
+
+    private:
+        std::shared_ptr<RasterJob> m_job;
+        ListingMap* m_listingmap;
+};
+
+class ListingMap::HeatmapWorker: public QRunnable
+{
+    public:
+        HeatmapWorker(const std::shared_ptr<Heatmap>& heatmap, ListingMap* listingmap, size_t first, size_t last): m_heatmap(heatmap), m_listingmap(listingmap), m_first(first), m_last(last) { }
+
+        void run() override
+        {
+            REDasm::AbstractBuffer* buffer = m_heatmap->disassembler->loader()->buffer();
+            const u8* data = reinterpret_cast<const u8*>(buffer->data());
+            size_t size = buffer->size();
+
+            for(size_t i = m_first; i < m_last; i++)
+            {
+                if(m_heatmap->cancelled)
+                    return;
+
+                size_t offset = i * HEATMAP_WINDOW_SIZE;
+                ListingMap::scanWindow(data + offset, std::min<size_t>(HEATMAP_WINDOW_SIZE, size - offset), &m_heatmap->entropy[i], &m_heatmap->classes[i]);
+            }
+
+            if(--m_heatmap->pending == 0) // Last chunk
+                QMetaObject::invokeMethod(m_listingmap, "onHeatmapCompleted", Qt::QueuedConnection);
+        }
+
+    private:
+        std::shared_ptr<Heatmap> m_heatmap;
+        ListingMap* m_listingmap;
+        size_t m_first, m_last;
+};
+
+ListingMap::ListingMap(QWidget *parent) : QWidget(parent), m_disassembler(nullptr), m_rastergeneration(0), m_orientation(Qt::Vertical), m_totalsize(0), m_mode(ListingMap::SegmentsMode)
+{
+    m_rasterpool.setMaxThreadCount(1);
     this->setBackgroundRole(QPalette::Base);
     this->setAutoFillBackground(true);
 }
 
+ListingMap::~ListingMap()
+{
+    if(m_disassembler)
+    {
+        EVENT_DISCONNECT(m_disassembler->document()->cursor(), positionChanged, this);
+        EVENT_DISCONNECT(m_disassembler->document(), changed, this);
+        EVENT_DISCONNECT(m_disassembler, busyChanged, this);
+    }
+
+    this->cancelRaster();
+    this->cancelHeatmap();
+    m_rasterpool.waitForDone();
+    m_heatmappool.waitForDone();
+}
+
 void ListingMap::setDisassembler(const REDasm::DisassemblerPtr& disassembler)
 {
     m_disassembler = disassembler;
     m_totalsize = disassembler->loader()->buffer()->size();
 
     auto& document = m_disassembler->document();
-    this->update();
+    this->computeHeatmap(); // Needs the buffer only, don't wait for analysis
+    this->rebuildRaster();
 
     EVENT_CONNECT(document->cursor(), positionChanged, this, [=]() {
         if(m_disassembler->busy())
             return;
 
-        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection); // Seek overlay only
+    });
+
+    EVENT_CONNECT(document, changed, this, [=](const REDasm::ListingDocumentChanged* ldc) {
+        if(m_disassembler->busy() || !ldc->item->is(REDasm::ListingItem::FunctionItem)) // Rebuilt once analysis is done
+            return;
+
+        if(ldc->isInserted())
+            QMetaObject::invokeMethod(this, "patchFunction", Qt::QueuedConnection, Q_ARG(address_t, ldc->item->address));
+        else if(ldc->isRemoved()) // Segments below have to be restored
+            QMetaObject::invokeMethod(this, "rebuildRaster", Qt::QueuedConnection);
     });
 
     EVENT_CONNECT(m_disassembler, busyChanged, this, [=]() {
         if(m_disassembler->busy())
             return;
 
-        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(this, "rebuildRaster", Qt::QueuedConnection);
     });
 }
 
 QSize ListingMap::sizeHint() const { return { LISTINGMAP_SIZE, LISTINGMAP_SIZE }; }
-int ListingMap::calculateSize(u64 sz) const { return std::max(1, static_cast<int>((sz * this->itemSize()) / m_totalsize)); }
-int ListingMap::calculatePosition(offset_t offset) const { return (offset * this->itemSize()) / m_totalsize; }
-int ListingMap::itemSize() const { return (m_orientation == Qt::Horizontal) ? this->width() : this->height(); }
 
-QRect ListingMap::buildRect(int p, int itemsize) const
+void ListingMap::setMode(s32 mode)
 {
-    if(m_orientation == Qt::Horizontal)
-        return QRect(p, 0, itemsize, this->height());
+    if(m_mode == mode)
+        return;
+
+    m_mode = mode;
+    this->rebuildRaster();
+}
+int ListingMap::MapMetrics::calculateSize(u64 sz) const { return std::max(1, static_cast<int>((sz * this->itemSize()) / totalsize)); }
+int ListingMap::MapMetrics::calculatePosition(offset_t offset) const { return (offset * this->itemSize()) / totalsize; }
+int ListingMap::MapMetrics::itemSize() const { return (orientation == Qt::Horizontal) ? size.width() : size.height(); }
+
+QRect ListingMap::MapMetrics::buildRect(int p, int itemsize) const
+{
+    if(orientation == Qt::Horizontal)
+        return QRect(p, 0, itemsize, size.height());
 
-    return QRect(0, p, this->width(), itemsize);
+    return QRect(0, p, size.width(), itemsize);
 }
 
+ListingMap::MapMetrics ListingMap::metrics() const { return { this->size(), m_orientation, static_cast<u64>(m_totalsize) }; }
+
 bool ListingMap::checkOrientation()
 {
     s32 oldorientation = m_orientation;
@@ -60,6 +178,7 @@ void ListingMap::drawLabels(QPainter* painter)
 {
     QPalette palette = this->palette();
     QFontMetrics fm = painter->fontMetrics();
+    MapMetrics metrics = this->metrics();
     auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
 
     painter->setPen(palette.color(QPalette::HighlightedText));
@@ -69,8 +188,8 @@ void ListingMap::drawLabels(QPainter* painter)
         if(segment.is(REDasm::SegmentType::Bss))
             continue;
 
-        int pos = this->calculatePosition(segment.offset);
-        int segmentsize = this->calculateSize(segment.size());
+        int pos = metrics.calculatePosition(segment.offset);
+        int segmentsize = metrics.calculateSize(segment.size());
 
         if(segmentsize < fm.height()) // Don't draw labels on small segments
             continue;
@@ -90,57 +209,93 @@ void ListingMap::drawLabels(QPainter* painter)
     }
 }
 
-void ListingMap::renderSegments(QPainter* painter)
+void ListingMap::renderHeatmap(QPainter *painter, const RasterJob *job)
 {
-    auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
+    const MapMetrics& metrics = job->metrics;
+    const Heatmap* heatmap = job->heatmap.get();
+    size_t windows = heatmap->entropy.size();
+    int itemsize = metrics.itemSize();
+
+    for(int p = 0; p < itemsize; p++)
+    {
+        size_t first = (static_cast<u64>(p) * windows) / itemsize;
+        size_t last = std::max(first + 1, static_cast<size_t>((static_cast<u64>(p + 1) * windows) / itemsize));
+        last = std::min(last, windows);
+
+        if(first >= last)
+            break;
+
+        QColor c;
+
+        if(job->mode == ListingMap::EntropyMode) // Peaks stand out, a packed stub shouldn't be averaged away
+        {
+            float entropy = *std::max_element(heatmap->entropy.begin() + first, heatmap->entropy.begin() + last);
+            c = QColor::fromHsvF(0.66 * (1.0 - entropy), 1.0, 0.35 + (0.65 * entropy));
+        }
+        else
+        {
+            u64 r = 0, g = 0, b = 0;
+
+            for(size_t i = first; i < last; i++)
+            {
+                r += qRed(heatmap->classes[i]);
+                g += qGreen(heatmap->classes[i]);
+                b += qBlue(heatmap->classes[i]);
+            }
+
+            size_t count = last - first;
+            c = QColor(r / count, g / count, b / count);
+        }
+
+        painter->fillRect(metrics.buildRect(p, 1), c);
+    }
+}
+
+void ListingMap::renderSegments(QPainter* painter, const RasterJob* job)
+{
+    auto lock = REDasm::s_lock_safe_ptr(job->disassembler->document());
 
     for(const REDasm::Segment& segment : lock->segments())
     {
         if(segment.is(REDasm::SegmentType::Bss))
             continue;
 
-        QRect r = this->buildRect(this->calculatePosition(segment.offset),
-                                  this->calculateSize(segment.size()));
+        QRect r = job->metrics.buildRect(job->metrics.calculatePosition(segment.offset),
+                                         job->metrics.calculateSize(segment.size()));
 
         if(segment.is(REDasm::SegmentType::Code))
-            painter->fillRect(r, THEME_VALUE("label_fg"));
+            painter->fillRect(r, job->codebrush);
         else
-            painter->fillRect(r, THEME_VALUE("data_fg"));
+            painter->fillRect(r, job->databrush);
     }
 }
 
-void ListingMap::renderFunctions(QPainter *painter)
+void ListingMap::renderFunction(QPainter *painter, const RasterJob* job, const REDasm::Symbol* symbol, const REDasm::Graphing::FunctionGraph* g)
 {
-    auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
-    u64 fsize = (m_orientation == Qt::Horizontal ? this->height() : this->width()) / 2;
+    if(!symbol || !g)
+        return;
+
+    const MapMetrics& metrics = job->metrics;
+    u64 fsize = (metrics.orientation == Qt::Horizontal ? metrics.size.height() : metrics.size.width()) / 2;
 
-    for(const REDasm::ListingItem* item : lock->functions())
+    for(const auto& n : g->nodes())
     {
-        const REDasm::Symbol* symbol = lock->symbol(item->address);
-        const REDasm::Graphing::FunctionGraph* g = lock->functions().graph(item);
+        const REDasm::Graphing::FunctionBasicBlock* fbb = g->data(n);
 
-        if(!g)
+        if(!fbb)
             continue;
 
-        for(const auto& n : g->nodes())
-        {
-            const REDasm::Graphing::FunctionBasicBlock* fbb = g->data(n);
-
-            if(!fbb)
-                continue;
+        QRect r = metrics.buildRect(metrics.calculatePosition(fbb->startidx), metrics.calculateSize(fbb->count()));
 
-            QRect r = this->buildRect(this->calculatePosition(fbb->startidx), this->calculateSize(fbb->count()));
-
-            if(m_orientation == Qt::Horizontal)
-                r.setHeight(fsize);
-            else
-                r.setWidth(fsize);
+        if(metrics.orientation == Qt::Horizontal)
+            r.setHeight(fsize);
+        else
+            r.setWidth(fsize);
 
-            if(symbol->isLocked())
-                painter->fillRect(r, THEME_VALUE("locked_fg"));
-            else
-                painter->fillRect(r, THEME_VALUE("function_fg"));
-        }
+        if(symbol->isLocked())
+            painter->fillRect(r, job->lockedbrush);
+        else
+            painter->fillRect(r, job->functionbrush);
     }
 }
 
@@ -156,15 +311,17 @@ void ListingMap::renderSeek(QPainter *painter)
     if(!offset.valid)
         return;
 
-    QColor seekcolor = THEME_VALUE("seek");
+    QColor seekcolor = THEME_STYLE(THEME_STYLE_ID("seek")).color;
     seekcolor.setAlphaF(0.4);
 
     QRect r;
 
+    MapMetrics metrics = this->metrics();
+
     if(m_orientation == Qt::Horizontal)
-       r = QRect(this->calculatePosition(offset), 0, this->width() * 0.05, this->height());
+       r = QRect(metrics.calculatePosition(offset), 0, this->width() * 0.05, this->height());
     else
-       r = QRect(0, this->calculatePosition(offset), this->width(), this->height() * 0.05);
+       r = QRect(0, metrics.calculatePosition(offset), this->width(), this->height() * 0.05);
 
     painter->fillRect(r, seekcolor);
 }
@@ -174,16 +331,13 @@ void ListingMap::paintEvent(QPaintEvent *)
     if(!m_disassembler)
         return;
 
-    this->checkOrientation();
-
     QPainter painter(this);
     painter.setPen(Qt::transparent);
-    painter.fillRect(this->rect(), Qt::gray);
-
-    this->renderSegments(&painter);
 
-    if(!m_disassembler->busy()) // Don't render functions when disassembler is busy
-        this->renderFunctions(&painter);
+    if(m_raster) // Stretched while a raster for the new size is being built
+        painter.drawImage(this->rect(), m_raster->image);
+    else
+        painter.fillRect(this->rect(), Qt::gray);
 
     this->drawLabels(&painter);
 
@@ -194,5 +348,189 @@ void ListingMap::paintEvent(QPaintEvent *)
 void ListingMap::resizeEvent(QResizeEvent *e)
 {
     QWidget::resizeEvent(e);
+    this->rebuildRaster();
+}
+
+void ListingMap::rebuildRaster()
+{
+    if(!m_disassembler)
+        return;
+
+    this->cancelRaster();
+    this->checkOrientation();
+
+    auto job = std::make_shared<RasterJob>();
+    job->disassembler = m_disassembler;
+    job->mode = m_mode;
+    job->metrics = this->metrics();
+    job->pixelratio = this->devicePixelRatioF();
+    job->functions = !m_disassembler->busy(); // Don't render functions when disassembler is busy
+    job->codebrush = THEME_STYLE(THEME_STYLE_ID("label_fg")).brush;
+    job->databrush = THEME_STYLE(THEME_STYLE_ID("data_fg")).brush;
+    job->lockedbrush = THEME_STYLE(THEME_STYLE_ID("locked_fg")).brush;
+    job->functionbrush = THEME_STYLE(THEME_STYLE_ID("function_fg")).brush;
+    job->generation = ++m_rastergeneration;
+
+    if((m_mode != ListingMap::SegmentsMode) && m_heatmap && !m_heatmap->pending) // Segments are shown until it's ready
+        job->heatmap = m_heatmap;
+
+    job->cancelled = false;
+
+    if(job->metrics.size.isEmpty() || !m_totalsize)
+        return;
+
+    m_rasterjob = job;
+    m_rasterpool.start(new RasterWorker(job, this));
+}
+
+void ListingMap::cancelRaster()
+{
+    if(m_rasterjob)
+        m_rasterjob->cancelled = true;
+
+    m_rasterjob.reset();
+}
+
+void ListingMap::onRasterCompleted(u64 generation)
+{
+    if(!m_rasterjob || (m_rasterjob->generation != generation))
+        return;
+
+    m_raster = m_rasterjob;
+    m_rasterjob.reset();
     this->update();
 }
+
+void ListingMap::patchFunction(address_t address)
+{
+    if(!m_raster || !m_raster->functions)
+        return;
+
+    if(m_rasterjob) // Not current anymore, the pending raster will include it
+        return;
+
+    auto lock = REDasm::s_lock_safe_ptr(m_disassembler->document());
+    auto it = lock->functionItem(address);
+
+    if(it == lock->end())
+        return;
+
+    const REDasm::Graphing::FunctionGraph* g = lock->functions().graph(it->get());
+
+    if(!g) // Graph isn't ready yet
+    {
+        QMetaObject::invokeMethod(this, "rebuildRaster", Qt::QueuedConnection);
+        return;
+    }
+
+    QPainter painter(&m_raster->image);
+    painter.setPen(Qt::transparent);
+    ListingMap::renderFunction(&painter, m_raster.get(), lock->symbol(address), g);
+    painter.end();
+
+    this->update();
+}
+
+void ListingMap::onHeatmapCompleted()
+{
+    if(m_mode != ListingMap::SegmentsMode)
+        this->rebuildRaster();
+}
+
+void ListingMap::computeHeatmap()
+{
+    this->cancelHeatmap();
+
+    REDasm::AbstractBuffer* buffer = m_disassembler->loader()->buffer();
+    size_t windows = (buffer->size() + HEATMAP_WINDOW_SIZE - 1) / HEATMAP_WINDOW_SIZE;
+
+    if(!windows)
+        return;
+
+    size_t chunksize = std::max<size_t>(HEATMAP_CHUNK_SIZE, (windows + m_heatmappool.maxThreadCount() - 1) / m_heatmappool.maxThreadCount());
+    size_t chunks = (windows + chunksize - 1) / chunksize;
+
+    auto heatmap = std::make_shared<Heatmap>();
+    heatmap->disassembler = m_disassembler;
+    heatmap->entropy.resize(windows);
+    heatmap->classes.resize(windows);
+    heatmap->pending = static_cast<int>(chunks);
+    heatmap->cancelled = false;
+    m_heatmap = heatmap;
+
+    for(size_t i = 0; i < windows; i += chunksize)
+        m_heatmappool.start(new HeatmapWorker(heatmap, this, i, std::min(i + chunksize, windows)));
+}
+
+void ListingMap::cancelHeatmap()
+{
+    if(m_heatmap)
+        m_heatmap->cancelled = true;
+
+    m_heatmap.reset();
+}
+
+void ListingMap::scanWindow(const u8 *data, size_t size, float *entropy, QRgb *byteclass)
+{
+    u32 histograms[4][256] = { }; // Interleaved, consecutive bytes don't wait on the same counter
+    u32 counts[256];
+    size_t i = 0;
+
+    for( ; (i + 4) <= size; i += 4)
+    {
+        histograms[0][data[i]]++;
+        histograms[1][data[i + 1]]++;
+        histograms[2][data[i + 2]]++;
+        histograms[3][data[i + 3]]++;
+    }
+
+    for( ; i < size; i++)
+        histograms[0][data[i]]++;
+
+    for(int b = 0; b < 256; b++)
+        counts[b] = histograms[0][b] + histograms[1][b] + histograms[2][b] + histograms[3][b];
+
+    // H = log2(N) - (1/N) * sum(c * log2(c)), normalized over 8 bits
+    double sum = 0;
+
+    for(int b = 0; b < 256; b++)
+    {
+        if(counts[b])
+            sum += counts[b] * std::log2(static_cast<double>(counts[b]));
+    }
+
+    *entropy = static_cast<float>((std::log2(static_cast<double>(size)) - (sum / size)) / 8.0);
+
+    u64 ascii = counts['\t'] + counts['\n'] + counts['\r'], high = 0;
+
+    for(int b = 0x20; b < 0x7F; b++)
+        ascii += counts[b];
+
+    for(int b = 0x80; b < 0x100; b++)
+        high += counts[b];
+
+    *byteclass = qRgb(static_cast<int>((high * 255) / size), static_cast<int>((ascii * 255) / size), static_cast<int>((counts[0] * 255) / size));
+}
+
+void ListingMap::contextMenuEvent(QContextMenuEvent *e)
+{
+    QMenu menu(this);
+    QActionGroup group(&menu);
+
+    auto addMode = [&](const QString& text, s32 mode) {
+        QAction* action = menu.addAction(text);
+        action->setCheckable(true);
+        action->setChecked(m_mode == mode);
+        action->setData(mode);
+        group.addAction(action);
+    };
+
+    addMode("Segments", ListingMap::SegmentsMode);
+    addMode("Entropy", ListingMap::EntropyMode);
+    addMode("Byte Classes", ListingMap::ByteClassMode);
+
+    QAction* action = menu.exec(e->globalPos());
+
+    if(action)
+        this->setMode(action->data().toInt());
+}
@@ -2,35 +2,95 @@
 #define LISTINGMAP_H
 
 #include <QWidget>
+#include <QThreadPool>
+#include <QImage>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <redasm/disassembler/disassemblerapi.h>
+#include <redasm/graph/functiongraph.h>
 
 class ListingMap : public QWidget
 {
     Q_OBJECT
 
+    private:
+        struct MapMetrics {
+            QSize size;
+            s32 orientation;
+            u64 totalsize;
+
+            int itemSize() const;
+            int calculateSize(u64 sz) const;
+            int calculatePosition(offset_t offset) const;
+            QRect buildRect(int offset, int itemsize) const;
+        };
+
+        struct Heatmap {
+            REDasm::DisassemblerPtr disassembler;
+            std::vector<float> entropy; // One per HEATMAP_WINDOW_SIZE bytes, 0.0 - 1.0
+            std::vector<QRgb> classes;  // High, ASCII and zero byte ratios as red, green and blue
+            std::atomic<int> pending;   // Chunks still running
+            std::atomic_bool cancelled;
+        };
+
+        struct RasterJob {
+            REDasm::DisassemblerPtr disassembler;
+            std::shared_ptr<Heatmap> heatmap;
+            s32 mode;
+            MapMetrics metrics;
+            qreal pixelratio;
+            bool functions;
+            QBrush codebrush, databrush, lockedbrush, functionbrush;
+            QImage image;
+            u64 generation;
+            std::atomic_bool cancelled;
+        };
+
+        class RasterWorker;
+        class HeatmapWorker;
+
+    public:
+        enum: s32 { SegmentsMode = 0, EntropyMode, ByteClassMode };
+
     public:
         explicit ListingMap(QWidget *parent = 0);
+        virtual ~ListingMap();
         void setDisassembler(const REDasm::DisassemblerPtr &disassembler);
         QSize sizeHint() const override;
+        void setMode(s32 mode);
 
     private:
-        int calculateSize(u64 sz) const;
-        int calculatePosition(offset_t offset) const;
-        int itemSize() const;
-        QRect buildRect(int offset, int itemsize) const;
+        MapMetrics metrics() const;
         bool checkOrientation();
         void drawLabels(QPainter *painter);
-        void renderSegments(QPainter *painter);
-        void renderFunctions(QPainter *painter);
         void renderSeek(QPainter *painter);
+        void cancelRaster();
+        void computeHeatmap();
+        void cancelHeatmap();
+        static void scanWindow(const u8* data, size_t size, float* entropy, QRgb* byteclass);
+        static void renderHeatmap(QPainter *painter, const RasterJob* job);
+        static void renderSegments(QPainter *painter, const RasterJob* job);
+        static void renderFunction(QPainter *painter, const RasterJob* job, const REDasm::Symbol* symbol, const REDasm::Graphing::FunctionGraph* g);
+
+    private slots:
+        void rebuildRaster();
+        void onRasterCompleted(u64 generation);
+        void onHeatmapCompleted();
+        void patchFunction(address_t address);
 
     protected:
         void paintEvent(QPaintEvent*) override;
         void resizeEvent(QResizeEvent* e) override;
+        void contextMenuEvent(QContextMenuEvent* e) override;
 
     private:
         REDasm::DisassemblerPtr m_disassembler;
-        s32 m_orientation, m_totalsize;
+        QThreadPool m_rasterpool, m_heatmappool;
+        std::shared_ptr<RasterJob> m_rasterjob, m_raster; // Pending, current
+        std::shared_ptr<Heatmap> m_heatmap;
+        u64 m_rastergeneration;
+        s32 m_orientation, m_totalsize, m_mode;
 };
 
 #endif // LISTINGMAP_H